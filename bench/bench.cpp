@@ -0,0 +1,198 @@
+#include "BasicString.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//
+// Micro-benchmarks of BasicString against std::string, across size classes.
+// Results go to stdout as JSON, one record per (benchmark, impl, size):
+//
+//   ./bench [min_time_ms] > bench_output.txt
+//
+// Each case is repeated in growing batches until it has run for at least
+// min_time_ms (default 100), and the time per operation is reported.
+//
+
+namespace
+{
+    // keeps the compiler from optimizing a result away
+    template<typename T>
+    void keep(const T& value)
+    {
+        asm volatile("" : : "r"(&value) : "memory");
+    }
+
+    struct Result
+    {
+        const char* name;
+        const char* impl;
+        size_t size;
+        size_t iterations;
+        double ns_per_op;
+    };
+
+    template<typename Op>
+    Result run(const char* name, const char* impl, size_t size, double min_time_ms, Op op)
+    {
+        using clock = std::chrono::steady_clock;
+
+        size_t iterations = 1u;
+        while(true)
+        {
+            auto start = clock::now();
+            for(size_t i = 0u; i < iterations; ++i)
+                op();
+            std::chrono::duration<double, std::milli> elapsed = clock::now() - start;
+
+            if(elapsed.count() >= min_time_ms)
+                return {name, impl, size, iterations, elapsed.count() * 1e6 / iterations};
+
+            iterations *= 2u;
+        }
+    }
+
+    template<typename S>
+    void bench_all(const char* impl, size_t size, double min_time_ms, std::vector<Result>& results)
+    {
+        static const char needle[] = "XYZZYXYZ";
+        static const char chunk[] = "abcdefgh";
+
+        std::string text(size, 'a');
+        for(size_t i = 0u; i < size; ++i)
+            text[i] = static_cast<char>('a' + (i * 7u) % 26u);
+
+        std::string hay = text;
+        hay.replace(size - std::min(size, sizeof(needle) - 1), std::string::npos,
+                    needle, std::min(size, sizeof(needle) - 1));
+
+        results.push_back(run("construct", impl, size, min_time_ms, [&]
+        {
+            S s(text.data(), text.size());
+            keep(s);
+        }));
+
+        results.push_back(run("append_growth", impl, size, min_time_ms, [&]
+        {
+            S s;
+            for(size_t n = 0u; n < size; n += 8u)
+                s.append(chunk, 8u);
+            keep(s);
+        }));
+
+        {
+            S s(text.data(), text.size());
+            results.push_back(run("assign", impl, size, min_time_ms, [&]
+            {
+                s.assign(hay.data(), hay.size());
+                keep(s);
+            }));
+        }
+
+        {
+            S s(text.data(), text.size());
+            results.push_back(run("replace", impl, size, min_time_ms, [&]
+            {
+                s.replace(size / 4u, 4u, chunk, 8u); // grows
+                s.replace(size / 4u, 8u, chunk, 4u); // shrinks back
+                keep(s);
+            }));
+        }
+
+        {
+            S s(hay.data(), hay.size());
+            size_t m = std::min(size, sizeof(needle) - 1);
+            results.push_back(run("find", impl, size, min_time_ms, [&]
+            {
+                size_t r = s.find(needle, 0u, m);
+                keep(r);
+            }));
+        }
+
+        {
+            S s(text.data(), text.size());
+            results.push_back(run("hash", impl, size, min_time_ms, [&]
+            {
+                size_t h = std::hash<S>{}(s);
+                keep(h);
+            }));
+        }
+
+        {
+            S s(text.data(), text.size());
+            S t(text.data(), text.size());
+            results.push_back(run("compare", impl, size, min_time_ms, [&]
+            {
+                bool r = s == t;
+                keep(r);
+            }));
+        }
+
+        {
+            S s(text.data(), text.size());
+            std::ostringstream os;
+            results.push_back(run("ostream", impl, size, min_time_ms, [&]
+            {
+                os.seekp(0);
+                os << s;
+                keep(os.tellp());
+            }));
+        }
+
+        {
+            S s(text.data(), text.size());
+            results.push_back(run("substr", impl, size, min_time_ms, [&]
+            {
+                S sub = s.substr(size / 4u, size / 2u);
+                keep(sub);
+            }));
+        }
+
+        {
+            S s(text.data(), text.size());
+            results.push_back(run("copy", impl, size, min_time_ms, [&]
+            {
+                S c = s;
+                keep(c);
+            }));
+        }
+
+        {
+            S s(text.data(), text.size());
+            results.push_back(run("move", impl, size, min_time_ms, [&]
+            {
+                S m = std::move(s);
+                keep(m);
+                s = std::move(m);
+            }));
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double min_time_ms = argc > 1 ? std::atof(argv[1]) : 100.0;
+
+    const size_t sizes[] = { 8u, 32u, 256u, 4096u, 65536u };
+
+    std::vector<Result> results;
+    for(size_t size : sizes)
+    {
+        bench_all<String>("BasicString", size, min_time_ms, results);
+        bench_all<std::string>("std::string", size, min_time_ms, results);
+    }
+
+    std::printf("{\n  \"benchmarks\": [\n");
+    for(size_t i = 0u; i < results.size(); ++i)
+    {
+        const Result& r = results[i];
+        std::printf("    {\"name\": \"%s\", \"impl\": \"%s\", \"size\": %zu, \"iterations\": %zu, \"ns_per_op\": %.3f}%s\n",
+                    r.name, r.impl, r.size, r.iterations, r.ns_per_op,
+                    i + 1 < results.size() ? "," : "");
+    }
+    std::printf("  ]\n}\n");
+}
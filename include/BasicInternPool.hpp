@@ -0,0 +1,301 @@
+#pragma once
+
+#include "BasicString.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+//
+// A pool of interned strings: each distinct contents is stored once, and
+// interning it again gives the same handle back. Handles are a pointer in
+// size, compare equal in O(1) exactly when the contents do, and give a
+// stable view of the contents for as long as the pool lives.
+//
+// The pool is safe to use from any number of threads at once. It is split
+// into shards by hash, each with a table and an arena of its own:
+//
+// - looking up what is already interned takes no lock at all; the table
+//   slots are atomic, and a table replaced on growth is kept (not freed)
+//   until the pool goes, so a reader never sees it go away under it,
+// - interning something new locks only the one shard it hashes to.
+//
+// Nothing is ever removed.
+//
+template<typename CharT>
+class BasicInternPool
+{
+    struct entry_t;
+
+    static_assert( std::is_trivial_v<CharT> );
+
+public:
+    using view_type = BasicStringView<CharT>;
+
+    class handle
+    {
+    public:
+        handle() = default; // the null handle, of no string
+
+        view_type view() const
+        {
+            return m_entry != nullptr ? view_type{chars_(m_entry), m_entry->size} : view_type{};
+        }
+
+        // null terminated
+        const CharT* c_str() const
+        {
+            static const CharT null = CharT();
+            return m_entry != nullptr ? chars_(m_entry) : std::addressof(null);
+        }
+
+        size_t size() const
+        {
+            return m_entry != nullptr ? m_entry->size : 0u;
+        }
+
+        // of the contents, as computed by the pool
+        size_t hash() const
+        {
+            return m_entry != nullptr ? m_entry->hash : 0u;
+        }
+
+        explicit operator bool() const
+        {
+            return m_entry != nullptr;
+        }
+
+        friend bool operator==(handle lhs, handle rhs)
+        {
+            return lhs.m_entry == rhs.m_entry;
+        }
+
+        friend bool operator!=(handle lhs, handle rhs)
+        {
+            return !(lhs == rhs);
+        }
+
+        // an arbitrary (not lexicographic) but consistent order
+        friend bool operator<(handle lhs, handle rhs)
+        {
+            return std::less<const entry_t*>{}(lhs.m_entry, rhs.m_entry);
+        }
+
+    private:
+        friend class BasicInternPool;
+
+        explicit handle(const entry_t* e)
+            : m_entry(e)
+        {
+        }
+
+        const entry_t* m_entry = nullptr;
+    };
+
+    BasicInternPool()
+        : m_shards(new shard_t[shard_count_])
+    {
+    }
+
+    BasicInternPool(const BasicInternPool&) = delete;
+    BasicInternPool& operator=(const BasicInternPool&) = delete;
+
+    //////////////////////////
+
+    // the handle of str, which is added to the pool if it is not there yet
+    handle intern(view_type str)
+    {
+        size_t h = hash_(str);
+        shard_t& shard = m_shards[shard_of_(h)];
+
+        if(const entry_t* e = lookup_(shard, h, str))
+            return handle{e};
+
+        std::lock_guard<std::mutex> lock{shard.mutex};
+
+        // look again, as another thread may have added it since
+        table_t* t = shard.table.load(std::memory_order_relaxed);
+        if(t != nullptr)
+        {
+            if(const entry_t* e = probe_(*t, h, str))
+                return handle{e};
+        }
+
+        if(t == nullptr || (shard.count.load(std::memory_order_relaxed) + 1u) * 2u > t->mask + 1u)
+            t = grow_(shard);
+
+        const entry_t* e = make_entry_(shard, h, str);
+        place_(*t, e);
+        shard.count.store(shard.count.load(std::memory_order_relaxed) + 1u, std::memory_order_relaxed);
+
+        return handle{e};
+    }
+
+    // the handle of str, or the null handle if it is not in the pool
+    handle find(view_type str) const
+    {
+        size_t h = hash_(str);
+        return handle{lookup_(m_shards[shard_of_(h)], h, str)};
+    }
+
+    // number of distinct strings interned
+    size_t size() const
+    {
+        size_t res = 0u;
+        for(size_t i = 0u; i < shard_count_; ++i)
+            res += m_shards[i].count.load(std::memory_order_relaxed);
+
+        return res;
+    }
+
+private:
+    // followed by the chars, and a null
+    struct entry_t
+    {
+        size_t hash;
+        size_t size;
+    };
+
+    static_assert( alignof(CharT) <= alignof(entry_t) );
+
+    // open addressing, with linear probing; at most half full
+    struct table_t
+    {
+        explicit table_t(size_t capacity)
+            : mask(capacity - 1u)
+            , slots(new std::atomic<const entry_t*>[capacity])
+        {
+            for(size_t i = 0u; i < capacity; ++i)
+                slots[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        size_t mask;
+        std::unique_ptr<std::atomic<const entry_t*>[]> slots;
+    };
+
+    struct alignas(64) shard_t
+    {
+        std::atomic<table_t*> table{nullptr};
+        std::atomic<size_t> count{0u};
+
+        std::mutex mutex; // for the rest, and for changes to the above
+        std::vector<std::unique_ptr<table_t>> tables; // the current one, and the ones it replaced
+
+        std::vector<std::unique_ptr<std::max_align_t[]>> chunks;
+        unsigned char* free = nullptr; // in the chunk being filled
+        size_t room = 0u;
+    };
+
+    static constexpr size_t shard_bits_ = 6u;
+    static constexpr size_t shard_count_ = size_t(1) << shard_bits_;
+    static constexpr size_t chunk_bytes_ = 64u * 1024u;
+
+    static const CharT* chars_(const entry_t* e)
+    {
+        return reinterpret_cast<const CharT*>(e + 1);
+    }
+
+    static size_t hash_(view_type str)
+    {
+        return BasicStringHash<CharT>{}(str);
+    }
+
+    // the top bits pick the shard, and the bottom ones the slot within it
+    static size_t shard_of_(size_t h)
+    {
+        return h >> (std::numeric_limits<size_t>::digits - shard_bits_);
+    }
+
+    static const entry_t* probe_(const table_t& t, size_t h, view_type str)
+    {
+        for(size_t i = h; ; ++i)
+        {
+            const entry_t* e = t.slots[i & t.mask].load(std::memory_order_acquire);
+            if(e == nullptr)
+                return nullptr;
+
+            if(e->hash == h && view_type{chars_(e), e->size} == str)
+                return e;
+        }
+    }
+
+    // lock free; may miss what is being added at the same time
+    static const entry_t* lookup_(const shard_t& shard, size_t h, view_type str)
+    {
+        const table_t* t = shard.table.load(std::memory_order_acquire);
+        return t != nullptr ? probe_(*t, h, str) : nullptr;
+    }
+
+    static void place_(table_t& t, const entry_t* e)
+    {
+        size_t i = e->hash;
+        while(t.slots[i & t.mask].load(std::memory_order_relaxed) != nullptr)
+            ++i;
+
+        t.slots[i & t.mask].store(e, std::memory_order_release);
+    }
+
+    // under the lock; replaces the table with one twice the size
+    static table_t* grow_(shard_t& shard)
+    {
+        table_t* old = shard.table.load(std::memory_order_relaxed);
+
+        auto t = std::make_unique<table_t>(old != nullptr ? (old->mask + 1u) * 2u : 64u);
+        if(old != nullptr)
+        {
+            for(size_t i = 0u; i <= old->mask; ++i)
+            {
+                if(const entry_t* e = old->slots[i].load(std::memory_order_relaxed))
+                    place_(*t, e);
+            }
+        }
+
+        shard.tables.push_back(std::move(t));
+        shard.table.store(shard.tables.back().get(), std::memory_order_release);
+
+        return shard.tables.back().get();
+    }
+
+    // under the lock; copies str into the arena of the shard
+    static const entry_t* make_entry_(shard_t& shard, size_t h, view_type str)
+    {
+        size_t bytes = sizeof(entry_t) + (str.size() + 1u) * sizeof(CharT);
+        bytes = (bytes + alignof(entry_t) - 1u) / alignof(entry_t) * alignof(entry_t);
+
+        unsigned char* p = nullptr;
+        if(bytes > chunk_bytes_ / 4u)
+        {
+            // big ones get a block of their own, so as not to waste the chunk
+            shard.chunks.emplace_back(new std::max_align_t[(bytes + sizeof(std::max_align_t) - 1u) / sizeof(std::max_align_t)]);
+            p = reinterpret_cast<unsigned char*>(shard.chunks.back().get());
+        }
+        else
+        {
+            if(bytes > shard.room)
+            {
+                shard.chunks.emplace_back(new std::max_align_t[chunk_bytes_ / sizeof(std::max_align_t)]);
+                shard.free = reinterpret_cast<unsigned char*>(shard.chunks.back().get());
+                shard.room = chunk_bytes_;
+            }
+
+            p = shard.free;
+            shard.free += bytes;
+            shard.room -= bytes;
+        }
+
+        entry_t* e = ::new(p) entry_t{h, str.size()};
+        CharT* chars = reinterpret_cast<CharT*>(e + 1);
+        std::copy(str.data(), str.data() + str.size(), chars);
+        chars[str.size()] = CharT();
+
+        return e;
+    }
+
+private:
+    std::unique_ptr<shard_t[]> m_shards;
+};
+
+using InternPool = BasicInternPool<char>;
+using wInternPool = BasicInternPool<wchar_t>;
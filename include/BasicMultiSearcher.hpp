@@ -0,0 +1,280 @@
+#pragma once
+
+#include "BasicString.hpp"
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <vector>
+
+//
+// Searches a text for any number of patterns at once, in a single pass
+// (Aho-Corasick). Every match of every pattern is reported, overlapping
+// ones included, in the order in which they end in the text.
+//
+// The patterns are compiled into a DFA, flattened into one table with a row
+// per state. The first cell of a row is the state to report matches from
+// (0 for none), the rest are the transitions, one per class of chars. Chars
+// that appear in no pattern share class 0, so rows are only as wide as the
+// alphabet of the patterns. Scanning costs one lookup per char, plus the
+// matches reported; the table costs 4 bytes per state and class.
+//
+// Chars are told apart with Traits, so the matching is case-insensitive
+// with case-insensitive traits, say.
+//
+template<typename CharT, typename Traits = std::char_traits<CharT>>
+class BasicMultiSearcher
+{
+public:
+    using view_type = BasicStringView<CharT, Traits>;
+
+    struct match
+    {
+        size_t pattern;   // index, in the order the patterns were given
+        size_t position;  // of the first char of the match in the text
+    };
+
+    BasicMultiSearcher(std::initializer_list<view_type> patterns)
+        : BasicMultiSearcher(patterns.begin(), patterns.end())
+    {
+    }
+
+    // from anything iterable whose elements convert to a view
+    template<typename Range>
+    explicit BasicMultiSearcher(const Range& patterns)
+        : BasicMultiSearcher(std::begin(patterns), std::end(patterns))
+    {
+    }
+
+    template<typename It>
+    BasicMultiSearcher(It first, It last)
+    {
+        m_offsets.push_back(0u);
+        for(; first != last; ++first)
+        {
+            view_type p = *first;
+            if(p.empty())
+                throw std::invalid_argument{"empty pattern"};
+
+            m_patterns.append(p.data(), p.size());
+            m_offsets.push_back(m_patterns.size());
+        }
+
+        build_classes_();
+        build_trie_();
+        build_links_();
+    }
+
+    //////////////////////////
+
+    // number of patterns
+    size_t size() const
+    {
+        return m_offsets.size() - 1u;
+    }
+
+    view_type pattern(size_t index) const
+    {
+        assert(index < size());
+
+        return view_type{m_patterns.data() + m_offsets[index], m_offsets[index + 1] - m_offsets[index]};
+    }
+
+    //////////////////////////
+
+    // calls f(const match&) for each match in text
+    template<typename F>
+    void for_each_match(view_type text, F&& f) const
+    {
+        scan_(text, [&f](const match& m)
+        {
+            f(m);
+            return true;
+        });
+    }
+
+    std::vector<match> find_all(view_type text) const
+    {
+        std::vector<match> res;
+        for_each_match(text, [&res](const match& m)
+        {
+            res.push_back(m);
+        });
+
+        return res;
+    }
+
+    // whether any pattern occurs in text; stops at the first match
+    bool contains_any(view_type text) const
+    {
+        return !scan_(text, [](const match&)
+        {
+            return false;
+        });
+    }
+
+private:
+    static constexpr uint32_t none_ = static_cast<uint32_t>(-1);
+
+    // chars that compare equal with Traits share a class; 0 is for those in no pattern
+    void build_classes_()
+    {
+        if constexpr(sizeof(CharT) == 1u)
+        {
+            m_classes = 1u;
+            for(size_t i = 0u; i < m_patterns.size(); ++i)
+            {
+                CharT ch = m_patterns[i];
+                if(m_byte_class[static_cast<unsigned char>(ch)] != 0u)
+                    continue;
+
+                for(size_t b = 0u; b < 256u; ++b)
+                {
+                    if(m_byte_class[b] == 0u && Traits::eq(static_cast<CharT>(b), ch))
+                        m_byte_class[b] = static_cast<uint16_t>(m_classes);
+                }
+
+                ++m_classes;
+            }
+        }
+        else
+        {
+            auto lt = [](CharT a, CharT b) { return Traits::lt(a, b); };
+            auto eq = [](CharT a, CharT b) { return Traits::eq(a, b); };
+
+            m_alphabet.assign(m_patterns.data(), m_patterns.data() + m_patterns.size());
+            std::sort(m_alphabet.begin(), m_alphabet.end(), lt);
+            m_alphabet.erase(std::unique(m_alphabet.begin(), m_alphabet.end(), eq), m_alphabet.end());
+
+            m_classes = m_alphabet.size() + 1u;
+        }
+
+        m_stride = m_classes + 1u;
+    }
+
+    size_t class_of_(CharT ch) const
+    {
+        if constexpr(sizeof(CharT) == 1u)
+        {
+            return m_byte_class[static_cast<unsigned char>(ch)];
+        }
+        else
+        {
+            auto it = std::lower_bound(m_alphabet.begin(), m_alphabet.end(), ch,
+                                       [](CharT a, CharT b) { return Traits::lt(a, b); });
+
+            return it != m_alphabet.end() && Traits::eq(*it, ch) ? it - m_alphabet.begin() + 1 : 0u;
+        }
+    }
+
+    uint32_t add_state_()
+    {
+        size_t id = m_terminal.size();
+        if(id >= none_)
+            throw std::length_error("too many states");
+
+        m_table.resize(m_table.size() + m_stride, none_);
+        m_table[id * m_stride] = 0u;
+        m_terminal.push_back(none_);
+
+        return static_cast<uint32_t>(id);
+    }
+
+    // the trie of the patterns, with missing transitions left as none_
+    void build_trie_()
+    {
+        add_state_(); // the root
+        m_same.assign(size(), none_);
+
+        for(size_t p = 0u; p < size(); ++p)
+        {
+            uint32_t s = 0u;
+            for(CharT ch : pattern(p))
+            {
+                size_t cell = s * m_stride + 1u + class_of_(ch);
+                if(m_table[cell] == none_)
+                {
+                    uint32_t t = add_state_();
+                    m_table[cell] = t;
+                }
+
+                s = m_table[cell];
+            }
+
+            // patterns ending in the same state are chained
+            m_same[p] = m_terminal[s];
+            m_terminal[s] = static_cast<uint32_t>(p);
+        }
+    }
+
+    // the failure links, which turn the trie into a DFA, in breadth first order
+    void build_links_()
+    {
+        m_fail.assign(m_terminal.size(), 0u);
+
+        std::vector<uint32_t> queue{0u};
+        for(size_t q = 0u; q < queue.size(); ++q)
+        {
+            uint32_t s = queue[q];
+            for(size_t c = 0u; c < m_classes; ++c)
+            {
+                size_t cell = s * m_stride + 1u + c;
+                uint32_t fallback = s == 0u ? 0u : m_table[m_fail[s] * m_stride + 1u + c];
+
+                uint32_t t = m_table[cell];
+                if(t == none_)
+                {
+                    m_table[cell] = fallback;
+                    continue;
+                }
+
+                m_fail[t] = fallback;
+                m_table[t * m_stride] = m_terminal[t] != none_ ? t : m_table[fallback * m_stride];
+                queue.push_back(t);
+            }
+        }
+    }
+
+    // calls f(match) for each match, until it returns false; false if it did
+    template<typename F>
+    bool scan_(view_type text, F&& f) const
+    {
+        const uint32_t* table = m_table.data();
+
+        size_t s = 0u;
+        for(size_t i = 0u; i < text.size(); ++i)
+        {
+            s = table[s * m_stride + 1u + class_of_(text[i])];
+
+            for(uint32_t o = table[s * m_stride]; o != 0u; o = table[m_fail[o] * m_stride])
+            {
+                for(uint32_t p = m_terminal[o]; p != none_; p = m_same[p])
+                {
+                    size_t len = m_offsets[p + 1] - m_offsets[p];
+                    if(!f(match{p, i + 1u - len}))
+                        return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+private:
+    BasicString<CharT, Traits> m_patterns;     // all of them, back to back
+    std::vector<size_t> m_offsets;             // of each in m_patterns, and the end
+
+    std::array<uint16_t, 256> m_byte_class{};  // for 1 byte chars
+    std::vector<CharT> m_alphabet;             // for others: sorted, one per class
+    size_t m_classes = 0u;
+    size_t m_stride = 0u;                      // of the rows of m_table
+
+    std::vector<uint32_t> m_table;             // the DFA
+    std::vector<uint32_t> m_fail;              // failure link of each state
+    std::vector<uint32_t> m_terminal;          // a pattern ending in each state, or none_
+    std::vector<uint32_t> m_same;              // the next pattern ending in the same state
+};
+
+using MultiSearcher = BasicMultiSearcher<char>;
+using wMultiSearcher = BasicMultiSearcher<wchar_t>;
@@ -0,0 +1,367 @@
+#pragma once
+
+#include "BasicString.hpp"
+
+#include <memory>
+#include <ostream>
+
+//
+// A rope: the text is held in BasicString leaves of bounded size, joined by
+// concatenation nodes into a height balanced (AVL) tree. Nodes are immutable
+// and shared, so copies and substr() share structure, while insert, erase
+// and substr cost O(log n) plus the copy of at most two leaves.
+//
+// The text is only flattened into one BasicString when asked to by str();
+// for_each_chunk() walks the leaves in order without flattening.
+//
+template<typename CharT,
+         typename Traits = std::char_traits<CharT>,
+         typename Allocator = std::allocator<CharT>>
+class BasicRope
+{
+public:
+    using string_type = BasicString<CharT, Traits, Allocator>;
+    using value_type = CharT;
+    using traits_type = Traits;
+
+    static constexpr size_t npos = -1;
+
+    BasicRope() = default;
+
+    BasicRope(const CharT* buf, size_t sz)
+        : m_root(build_(buf, sz))
+    {
+    }
+
+    BasicRope(const CharT* buf)
+        : BasicRope(buf, Traits::length(buf))
+    {
+    }
+
+    explicit BasicRope(const string_type& str)
+        : BasicRope(str.data(), str.size())
+    {
+    }
+
+    //////////////////////////
+
+    size_t size() const
+    {
+        return size_(m_root);
+    }
+
+    bool empty() const
+    {
+        return size() == 0u;
+    }
+
+    CharT operator[](size_t index) const
+    {
+        assert(index < size());
+
+        const node_t* n = m_root.get();
+        while(n->left != nullptr)
+        {
+            if(index < n->left->size)
+            {
+                n = n->left.get();
+            }
+            else
+            {
+                index -= n->left->size;
+                n = n->right.get();
+            }
+        }
+
+        return n->text[index];
+    }
+
+    CharT at(size_t index) const
+    {
+        if(index >= size())
+            throw std::out_of_range{"bad index"};
+
+        return (*this)[index];
+    }
+
+    //////////////////////////
+
+    BasicRope& append(const BasicRope& rhs)
+    {
+        m_root = join_(m_root, rhs.m_root);
+        return *this;
+    }
+
+    BasicRope& append(const CharT* buf, size_t sz)
+    {
+        return append(BasicRope{buf, sz});
+    }
+
+    BasicRope& append(const CharT* buf)
+    {
+        return append(BasicRope{buf});
+    }
+
+    BasicRope& append(const string_type& str)
+    {
+        return append(BasicRope{str});
+    }
+
+    BasicRope& insert(size_t index, const BasicRope& rope)
+    {
+        if(index > size())
+            throw std::out_of_range{"bad index"};
+
+        auto [lhs, rhs] = split_(m_root, index);
+        m_root = join_(join_(lhs, rope.m_root), rhs);
+        return *this;
+    }
+
+    BasicRope& insert(size_t index, const CharT* buf, size_t sz)
+    {
+        return insert(index, BasicRope{buf, sz});
+    }
+
+    BasicRope& insert(size_t index, const CharT* buf)
+    {
+        return insert(index, BasicRope{buf});
+    }
+
+    BasicRope& insert(size_t index, const string_type& str)
+    {
+        return insert(index, BasicRope{str});
+    }
+
+    BasicRope& erase(size_t index, size_t count = npos)
+    {
+        if(index > size())
+            throw std::out_of_range{"bad index"};
+
+        auto [lhs, rest] = split_(m_root, index);
+        auto [mid, rhs] = split_(rest, std::min(count, size_(rest)));
+        m_root = join_(lhs, rhs);
+        return *this;
+    }
+
+    BasicRope substr(size_t index = 0, size_t count = npos) const
+    {
+        if(index > size())
+            throw std::out_of_range{"bad index"};
+
+        auto [lhs, rest] = split_(m_root, index);
+        auto [mid, rhs] = split_(rest, std::min(count, size_(rest)));
+
+        BasicRope res;
+        res.m_root = mid;
+        return res;
+    }
+
+    //////////////////////////
+
+    // calls f(const CharT* chunk, size_t size) for each leaf, in order
+    template<typename F>
+    void for_each_chunk(F&& f) const
+    {
+        if(m_root != nullptr)
+            for_each_chunk_(*m_root, f);
+    }
+
+    // flattens the text, with one allocation
+    string_type str() const
+    {
+        string_type res;
+        res.resize_and_overwrite(size(), [this](CharT* p, size_t n)
+        {
+            for_each_chunk([&p](const CharT* chunk, size_t sz)
+            {
+                Traits::copy(p, chunk, sz);
+                p += sz;
+            });
+
+            return n;
+        });
+
+        return res;
+    }
+
+private:
+    struct node_t;
+    using node_ptr = std::shared_ptr<const node_t>;
+
+    struct node_t
+    {
+        string_type text;        // leaves only
+        node_ptr left, right;    // concatenations only
+        size_t size;
+        int height;              // 1 for leaves
+    };
+
+    // leaves are split to this size when built, and merged up to it when joined
+    static constexpr size_t leaf_capacity_ = 512u;
+
+    static size_t size_(const node_ptr& n)
+    {
+        return n != nullptr ? n->size : 0u;
+    }
+
+    static int height_(const node_ptr& n)
+    {
+        return n != nullptr ? n->height : 0;
+    }
+
+    static bool is_leaf_(const node_ptr& n)
+    {
+        return n->left == nullptr;
+    }
+
+    static node_ptr make_leaf_(string_type text)
+    {
+        size_t sz = text.size();
+        return std::make_shared<const node_t>(node_t{std::move(text), nullptr, nullptr, sz, 1});
+    }
+
+    static node_ptr make_concat_(node_ptr lhs, node_ptr rhs)
+    {
+        size_t sz = lhs->size + rhs->size;
+        int height = std::max(lhs->height, rhs->height) + 1;
+        return std::make_shared<const node_t>(node_t{string_type{}, std::move(lhs), std::move(rhs), sz, height});
+    }
+
+    static node_ptr build_(const CharT* buf, size_t sz)
+    {
+        if(sz == 0u)
+            return nullptr;
+
+        if(sz <= leaf_capacity_)
+            return make_leaf_(string_type{buf, sz});
+
+        // half of the leaves on each side, so the tree comes out balanced
+        size_t leaves = (sz + leaf_capacity_ - 1) / leaf_capacity_;
+        size_t left_sz = leaves / 2 * leaf_capacity_;
+
+        return make_concat_(build_(buf, left_sz), build_(buf + left_sz, sz - left_sz));
+    }
+
+    // concatenates subtrees whose heights differ by 2 at most
+    static node_ptr balance_(node_ptr lhs, node_ptr rhs)
+    {
+        if(lhs->height > rhs->height + 1)
+        {
+            if(height_(lhs->left) >= height_(lhs->right))
+                return make_concat_(lhs->left, make_concat_(lhs->right, std::move(rhs)));
+
+            return make_concat_(make_concat_(lhs->left, lhs->right->left),
+                                make_concat_(lhs->right->right, std::move(rhs)));
+        }
+
+        if(rhs->height > lhs->height + 1)
+        {
+            if(height_(rhs->right) >= height_(rhs->left))
+                return make_concat_(make_concat_(std::move(lhs), rhs->left), rhs->right);
+
+            return make_concat_(make_concat_(std::move(lhs), rhs->left->left),
+                                make_concat_(rhs->left->right, rhs->right));
+        }
+
+        return make_concat_(std::move(lhs), std::move(rhs));
+    }
+
+    static node_ptr merge_leaves_(const node_ptr& lhs, const node_ptr& rhs)
+    {
+        string_type text;
+        text.reserve(lhs->size + rhs->size);
+        text.append(lhs->text);
+        text.append(rhs->text);
+        return make_leaf_(std::move(text));
+    }
+
+    // concatenation in O(|height(lhs) - height(rhs)|)
+    static node_ptr join_(const node_ptr& lhs, const node_ptr& rhs)
+    {
+        if(lhs == nullptr) return rhs;
+        if(rhs == nullptr) return lhs;
+
+        if(lhs->height > rhs->height + 1)
+            return balance_(lhs->left, join_(lhs->right, rhs));
+
+        if(rhs->height > lhs->height + 1)
+            return balance_(join_(lhs, rhs->left), rhs->right);
+
+        // small pieces, as from appending a character at a time, are merged
+        // into a neighbouring leaf rather than getting a leaf of their own
+        if(lhs->size + rhs->size <= leaf_capacity_)
+        {
+            if(is_leaf_(lhs) && is_leaf_(rhs))
+                return merge_leaves_(lhs, rhs);
+        }
+
+        if(is_leaf_(rhs) && !is_leaf_(lhs) && is_leaf_(lhs->right)
+                && lhs->right->size + rhs->size <= leaf_capacity_)
+        {
+            return make_concat_(lhs->left, merge_leaves_(lhs->right, rhs));
+        }
+
+        if(is_leaf_(lhs) && !is_leaf_(rhs) && is_leaf_(rhs->left)
+                && lhs->size + rhs->left->size <= leaf_capacity_)
+        {
+            return make_concat_(merge_leaves_(lhs, rhs->left), rhs->right);
+        }
+
+        return make_concat_(lhs, rhs);
+    }
+
+    // [0, index) and [index, size) of n
+    static std::pair<node_ptr, node_ptr> split_(const node_ptr& n, size_t index)
+    {
+        if(index == 0u) return {nullptr, n};
+        if(index == size_(n)) return {n, nullptr};
+
+        if(is_leaf_(n))
+        {
+            return {
+                make_leaf_(n->text.substr(0u, index)),
+                make_leaf_(n->text.substr(index))
+            };
+        }
+
+        if(index < n->left->size)
+        {
+            auto [lhs, rhs] = split_(n->left, index);
+            return {lhs, join_(rhs, n->right)};
+        }
+
+        auto [lhs, rhs] = split_(n->right, index - n->left->size);
+        return {join_(n->left, lhs), rhs};
+    }
+
+    template<typename F>
+    static void for_each_chunk_(const node_t& n, F& f)
+    {
+        if(n.left == nullptr)
+        {
+            f(n.text.data(), n.text.size());
+            return;
+        }
+
+        for_each_chunk_(*n.left, f);
+        for_each_chunk_(*n.right, f);
+    }
+
+private:
+    node_ptr m_root;
+};
+
+// writes the rope a chunk at a time, without flattening it
+template<typename CharT, typename Traits, typename Allocator>
+std::basic_ostream<CharT>& operator<<(std::basic_ostream<CharT>& os, const BasicRope<CharT, Traits, Allocator>& rhs)
+{
+    rhs.for_each_chunk([&os](const CharT* chunk, size_t sz)
+    {
+        os.write(chunk, static_cast<std::streamsize>(sz));
+    });
+
+    return os;
+}
+
+using Rope = BasicRope<char>;
+using wRope = BasicRope<wchar_t>;
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "BasicString.hpp"
+
+#include <istream>
+#include <stdexcept>
+
+//
+// Searches for a needle in a stream too big to hold in memory, fed to it a
+// chunk at a time. Every match is reported once, overlapping ones included,
+// at its offset from the start of the stream - across chunk boundaries too,
+// as the last needle size - 1 chars of each chunk are carried over to the
+// next one.
+//
+// The chunks go into one buffer, which is reused: once it has grown to the
+// size of a chunk plus the carry, a scan of any length makes no more
+// allocations. The search itself is that of BasicString::searcher.
+//
+template<typename CharT, typename Traits = std::char_traits<CharT>>
+class BasicStreamSearcher
+{
+    using string_type_ = BasicString<CharT, Traits>;
+
+public:
+    using view_type = BasicStringView<CharT, Traits>;
+
+    static constexpr size_t npos = string_type_::npos;
+    static constexpr size_t default_chunk = 64u * 1024u;
+
+    explicit BasicStreamSearcher(view_type needle)
+        : m_searcher(needle.data(), needle.size())
+    {
+        if(needle.empty())
+            throw std::invalid_argument{"empty needle"};
+    }
+
+    const string_type_& needle() const
+    {
+        return m_searcher.needle();
+    }
+
+    //////////////////////////
+
+    // calls f(offset) for each match that ends in chunk
+    template<typename F>
+    void feed(view_type chunk, F&& f)
+    {
+        m_buffer.append(chunk.data(), chunk.size());
+        scan_(f);
+    }
+
+    //
+    // Reads the rest of in, chunk chars at a time, straight into the buffer,
+    // and calls f(offset) for each match. Returns the number of chars read.
+    //
+    template<typename F>
+    size_t feed(std::basic_istream<CharT>& in, F&& f, size_t chunk = default_chunk)
+    {
+        m_buffer.reserve(needle().size() - 1u + chunk);
+
+        size_t total = 0u;
+        while(in)
+        {
+            size_t old_size = m_buffer.size();
+            in.read(m_buffer.append_uninitialized(chunk).data(), static_cast<std::streamsize>(chunk));
+
+            size_t got = static_cast<size_t>(in.gcount());
+            m_buffer.resize(old_size + got);
+            if(got == 0u)
+                break;
+
+            total += got;
+            scan_(f);
+        }
+
+        return total;
+    }
+
+    // the number of chars fed so far
+    size_t offset() const
+    {
+        return m_base + m_buffer.size();
+    }
+
+    // for a new stream; keeps the buffer
+    void reset()
+    {
+        m_buffer.clear();
+        m_base = 0u;
+    }
+
+    size_t capacity() const
+    {
+        return m_buffer.capacity();
+    }
+
+private:
+    // reports the matches in the buffer, and keeps only what the next ones may start in
+    template<typename F>
+    void scan_(F& f)
+    {
+        const CharT* p = m_buffer.data();
+        const size_t n = m_buffer.size();
+
+        for(size_t i = m_searcher.search(p, n); i != npos; )
+        {
+            f(m_base + i);
+
+            size_t r = ++i < n ? m_searcher.search(p + i, n - i) : npos;
+            i = r == npos ? npos : i + r;
+        }
+
+        size_t keep = std::min(n, needle().size() - 1u);
+        if(n > keep)
+        {
+            m_buffer.erase(0u, n - keep);
+            m_base += n - keep;
+        }
+    }
+
+private:
+    typename string_type_::searcher m_searcher;
+    string_type_ m_buffer; // the carry from the last chunk, then the new one
+    size_t m_base = 0u;    // offset in the stream of m_buffer[0]
+};
+
+using StreamSearcher = BasicStreamSearcher<char>;
+using wStreamSearcher = BasicStreamSearcher<wchar_t>;
@@ -1,9 +1,19 @@
+#pragma once
+
+#include "BasicStringView.hpp"
+#include "Simd.hpp"
+
 #include <utility>
+#include <memory>
+#include <string> // std::char_traits
 #include <stdexcept>
 #include <type_traits>
 #include <limits>
 #include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
 
 template<class T>
 T add_sat_(T a, T b)
@@ -20,65 +30,252 @@ T add_sat_(T a, T b)
     return res;
 }
 
-template<typename CharT>
+//
+// Instrumentation policy of BasicString: the static hooks below are called
+// on every allocation and free of a buffer, on every reallocation to grow,
+// and with the number of bytes every append or replace copies.
+//
+// This default one does nothing, and compiles away entirely. StringStats
+// (in StringStats.hpp) is one that keeps counts.
+//
+struct NoStringStats
+{
+    static void on_allocate(size_t /* bytes */) {}
+    static void on_deallocate(size_t /* bytes */) {}
+    static void on_grow(size_t /* old_bytes */, size_t /* new_bytes */) {}
+    static void on_copy(size_t /* bytes */) {}
+};
+
+//
+// Growth policies of BasicString: when an append does not fit the capacity,
+// next_capacity(size, min_cap) picks the new one, which is at least min_cap
+// (in elements, not counting the null).
+//
+
+// grows by a factor of Num / Den, or to min_cap if that is more
+template<size_t Num, size_t Den>
+struct GeometricGrowth
+{
+    static_assert( Num > Den && Den > 0u );
+
+    template<typename CharT>
+    static size_t next_capacity(size_t size, size_t min_cap)
+    {
+        constexpr size_t step = Num - Den;
+
+        size_t grown = size > std::numeric_limits<size_t>::max() / step
+                     ? std::numeric_limits<size_t>::max()
+                     : size / Den * step + size % Den * step / Den;
+
+        return std::max(add_sat_(size, grown), min_cap);
+    }
+};
+
+using DoublingGrowth = GeometricGrowth<2u, 1u>;
+using HalfAgainGrowth = GeometricGrowth<3u, 2u>;
+
+//
+// Takes the capacity Base asks for, and rounds the buffer up to the size
+// classes of the usual malloc implementations, so that the slack the
+// allocator would hand out anyway becomes capacity: multiples of 16 bytes
+// up to 128, then four classes per power of two. Buffers of HugeBytes or
+// more are rounded up to whole pages instead.
+//
+template<typename Base = DoublingGrowth, size_t PageSize = 4096u, size_t HugeBytes = 128u * 1024u>
+struct SizeClassGrowth
+{
+    template<typename CharT>
+    static size_t next_capacity(size_t size, size_t min_cap)
+    {
+        size_t cap = Base::template next_capacity<CharT>(size, min_cap);
+        if(cap >= std::numeric_limits<size_t>::max() / 2u / sizeof(CharT))
+            return cap; // would not fit anyway, left for the caller to reject
+
+        return size_class((cap + 1u) * sizeof(CharT), sizeof(CharT)) / sizeof(CharT) - 1u;
+    }
+
+    // the smallest class of at least bytes, in whole elements of elem_size
+    static size_t size_class(size_t bytes, size_t elem_size)
+    {
+        size_t spacing = 16u;
+        if(bytes >= HugeBytes)
+        {
+            spacing = PageSize;
+        }
+        else if(bytes > 128u)
+        {
+            while((spacing << 3) < bytes)
+                spacing <<= 1;
+        }
+
+        size_t res = (bytes + spacing - 1u) / spacing * spacing;
+        return res - res % elem_size;
+    }
+};
+
+template<typename CharT,
+         typename Traits = std::char_traits<CharT>,
+         typename Allocator = std::allocator<CharT>,
+         typename Instrumentation = NoStringStats,
+         typename Growth = DoublingGrowth>
 class BasicString
 {
+    using alloc_traits_ = std::allocator_traits<Allocator>;
+
+    static_assert( std::is_same_v<typename alloc_traits_::value_type, CharT> );
+    static_assert( std::is_same_v<typename alloc_traits_::pointer, CharT*> ); // no fancy pointers
+
+    // what converts to a view, but has no overloads of its own (as BasicString
+    // and C strings do); std::basic_string_view, say
+    template<typename T>
+    using if_view_like_ = std::enable_if_t<!std::is_same_v<T, BasicString>
+                                        && std::is_convertible_v<const T&, BasicStringView<CharT, Traits>>
+                                        && !std::is_convertible_v<const T&, const CharT*>, int>;
+
+    // what the comparison operators take, besides BasicString: views, C strings...
+    template<typename T>
+    using if_comparable_ = std::enable_if_t<!std::is_same_v<T, BasicString>
+                                         && std::is_convertible_v<const T&, BasicStringView<CharT, Traits>>, int>;
+
 public:
-    static const size_t npos = -1;
+    using value_type = CharT;
+    using traits_type = Traits;
+    using allocator_type = Allocator;
+    using view_type = BasicStringView<CharT, Traits>;
+
+    static constexpr size_t npos = -1;
+
+    // a writable window into the buffer, see append_uninitialized()
+    class span
+    {
+    public:
+        span(CharT* data, size_t size)
+            : m_data(data)
+            , m_size(size)
+        {
+        }
+
+        CharT* data() const { return m_data; }
+        size_t size() const { return m_size; }
+
+        CharT* begin() const { return m_data; }
+        CharT* end() const { return m_data + m_size; }
+
+        CharT& operator[](size_t index) const
+        {
+            assert(index < size());
+
+            return m_data[index];
+        }
+
+    private:
+        CharT* m_data;
+        size_t m_size;
+    };
 
     BasicString() = default;
 
-    BasicString(const CharT* buf, size_t sz)
-        : BasicString()
+    explicit BasicString(const Allocator& alloc) noexcept
+        : m_storage(alloc)
+    {
+    }
+
+    BasicString(const CharT* buf, size_t sz, const Allocator& alloc = Allocator())
+        : BasicString(alloc)
     {
         append(buf, sz);
     }
 
     template<size_t N>
-    BasicString(const CharT(&buf)[N])
-        : BasicString(buf, N - 1)
+    BasicString(const CharT(&buf)[N], const Allocator& alloc = Allocator())
+        : BasicString(buf, N - 1, alloc)
     {
     }
 
-    BasicString(const CharT* buf)
-        : BasicString(buf, strlen_(buf))
+    BasicString(const CharT* buf, const Allocator& alloc = Allocator())
+        : BasicString(buf, strlen_(buf), alloc)
     {
     }
 
+    template<typename T, if_view_like_<T> = 0>
+    explicit BasicString(const T& str, const Allocator& alloc = Allocator())
+        : BasicString(alloc)
+    {
+        view_type sv = str;
+        append(sv.data(), sv.size());
+    }
+
     BasicString(const BasicString& rhs)
-        : BasicString(rhs.m_data, rhs.m_size)
+        : BasicString(rhs, alloc_traits_::select_on_container_copy_construction(rhs.get_allocator_()))
+    {
+    }
+
+    BasicString(const BasicString& rhs, const Allocator& alloc)
+        : BasicString(rhs.data(), rhs.size(), alloc)
     {
     }
 
     BasicString(BasicString&& rhs) noexcept
-        : m_data(std::exchange(rhs.m_data, nullptr))
+        : m_storage(std::move(rhs.m_storage)) // steals the heap buffer, or copies the local one
         , m_size(std::exchange(rhs.m_size, 0u))
-        , m_capacity(std::exchange(rhs.m_capacity, 0u))
     {
+        rhs.m_storage.buf = buffer_t{};
+    }
+
+    BasicString(BasicString&& rhs, const Allocator& alloc)
+        : BasicString(alloc)
+    {
+        if(alloc_traits_::is_always_equal::value || get_allocator_() == rhs.get_allocator_())
+            swap_buffers_(rhs);
+        else
+            append(rhs.data(), rhs.size());
     }
 
     friend void swap(BasicString& lhs, BasicString& rhs) noexcept
     {
-        using std::swap;
+        if constexpr(alloc_traits_::propagate_on_container_swap::value)
+        {
+            using std::swap;
+
+            swap(lhs.get_allocator_(), rhs.get_allocator_());
+        }
+        else
+        {
+            // as with std containers, swapping with unequal allocators is undefined
+            assert( alloc_traits_::is_always_equal::value || lhs.get_allocator_() == rhs.get_allocator_() );
+        }
 
-        swap(lhs.m_size, rhs.m_size);
-        swap(lhs.m_capacity, rhs.m_capacity);
-        swap(lhs.m_data, rhs.m_data);
+        lhs.swap_buffers_(rhs);
     }
 
     BasicString& assign(BasicString&& rhs)
+        noexcept(alloc_traits_::propagate_on_container_move_assignment::value
+              || alloc_traits_::is_always_equal::value)
     {
-        using std::swap;
+        if constexpr(!alloc_traits_::propagate_on_container_move_assignment::value
+                  && !alloc_traits_::is_always_equal::value)
+        {
+            // cannot take over a buffer that our allocator cannot free
+            if(get_allocator_() != rhs.get_allocator_())
+                return assign(rhs.data(), rhs.size());
+        }
 
         BasicString tmp = std::move(rhs);
-        swap(*this, tmp);
+        if constexpr(alloc_traits_::propagate_on_container_move_assignment::value)
+        {
+            using std::swap;
+
+            // tmp releases our old buffer, so it needs our old allocator
+            swap(get_allocator_(), tmp.get_allocator_());
+        }
+        swap_buffers_(tmp);
         return *this;
     }
 
     void clear()
     {
         // std::destroy(data(), data() + size());
-        m_size = 0;
+        set_size_(0u);
     }
 
     BasicString& assign(const CharT* buf, size_t sz)
@@ -87,8 +284,8 @@ public:
         {
             using std::swap;
 
-            BasicString tmp{buf, sz};
-            swap(*this, tmp);
+            BasicString tmp{buf, sz, get_allocator_()};
+            swap_buffers_(tmp);
         };
 
         if constexpr(!std::is_nothrow_constructible_v<CharT>)
@@ -99,6 +296,15 @@ public:
         {
             assign_exsafe_();
         }
+        else if(points_into_(buf))
+        {
+            // a part of this string, moved down to the front
+            Traits::move(data(), buf, sz);
+            Traits::assign(*(data() + sz), CharT());
+            set_size_(sz);
+
+            Instrumentation::on_copy(sz * sizeof(CharT));
+        }
         else
         {
             clear();
@@ -115,14 +321,37 @@ public:
 
     BasicString& assign(const BasicString& rhs)
     {
+        if constexpr(alloc_traits_::propagate_on_container_copy_assignment::value)
+        {
+            if(!alloc_traits_::is_always_equal::value && get_allocator_() != rhs.get_allocator_())
+            {
+                using std::swap;
+
+                // our buffer cannot be reused, as it belongs to the old allocator
+                BasicString tmp{rhs, rhs.get_allocator_()};
+                swap(get_allocator_(), tmp.get_allocator_());
+                swap_buffers_(tmp);
+                return *this;
+            }
+
+            get_allocator_() = rhs.get_allocator_();
+        }
+
         return assign(rhs.data(), rhs.size());
     }
 
+    template<typename T, if_view_like_<T> = 0>
+    BasicString& assign(const T& str)
+    {
+        view_type sv = str;
+        return assign(sv.data(), sv.size());
+    }
+
     //////////////////////////
 
     BasicString& operator=(const BasicString& rhs)
     {
-        return assign(rhs.data(), rhs.size());
+        return assign(rhs);
     }
 
     BasicString& operator=(const CharT* buf)
@@ -130,14 +359,29 @@ public:
         return assign(buf);
     }
 
+    template<typename T, if_view_like_<T> = 0>
+    BasicString& operator=(const T& str)
+    {
+        return assign(str);
+    }
+
     BasicString& operator=(BasicString&& rhs)
+        noexcept(noexcept(std::declval<BasicString&>().assign(std::move(rhs))))
     {
         return assign(std::move(rhs));
     }
 
     ~BasicString()
     {
-        delete[] m_data; // TODO: use allocator
+        if(is_long_())
+        {
+            deallocate_(get_allocator_(), m_storage.buf.heap.data, m_storage.buf.heap.capacity);
+        }
+    }
+
+    allocator_type get_allocator() const
+    {
+        return get_allocator_();
     }
 
     //////////////////////////
@@ -152,28 +396,79 @@ public:
 
     void shrink_to_fit()
     {
-        if(size() < capacity())
+        if(is_long_() && size() < capacity())
         {
             set_capacity_exsafe_(size());
         }
     }
 
+    void resize(size_t count, CharT ch = CharT())
+    {
+        if(count > size())
+        {
+            span s = append_uninitialized(count - size());
+            Traits::assign(s.data(), s.size(), ch);
+        }
+        else
+        {
+            // std::destroy(data() + count, data() + size());
+            Traits::assign(*(data() + count), CharT());
+            set_size_(count);
+        }
+    }
+
+    //
+    // Lets op write up to count elements straight into the buffer, as in
+    // C++23. op(data(), count) is called with the current contents intact,
+    // and returns the new size, which must not exceed count.
+    // If op throws, the contents are unspecified (but valid).
+    //
+    template<typename Operation>
+    void resize_and_overwrite(size_t count, Operation op)
+    {
+        reserve(count);
+
+        size_t new_size = std::move(op)(data(), count);
+        assert(new_size <= count);
+
+        Traits::assign(*(data() + new_size), CharT());
+        set_size_(new_size);
+    }
+
+    //
+    // Grows the size by count, and returns the new elements for the caller
+    // to fill in (they are left as they were in the spare capacity). Use
+    // resize() to give back what was not filled in.
+    //
+    span append_uninitialized(size_t count)
+    {
+        grow_for_append_(count);
+
+        CharT* p = data() + size();
+        Traits::assign(*(p + count), CharT());
+        set_size_(size() + count);
+
+        return span{p, count};
+    }
+
     BasicString& append(const CharT* buf, size_t sz)
     {
         if(sz == 0) return *this; // quick return (minor optimization)
 
-        if(sz > spare_capacity_())
+        if(sz > spare_capacity_() && points_into_(buf))
         {
-            size_t new_cap = std::max(
-                                    add_sat_(size(), size()), // geometric progression
-                                    add_sat_(size(), sz)      // arithmetic progression
-                                );
-
-            set_capacity_exsafe_(new_cap);
+            // buf goes away with the old buffer, so it is copied into the new one first
+            set_capacity_exsafe_(grown_capacity_(sz), view_type{buf, sz});
+            return *this;
         }
 
-        *std::copy(buf, buf + sz, data() + size()) = *ptr_to_null(); // std::uninitialized_copy
-        m_size += sz;
+        grow_for_append_(sz);
+
+        Traits::copy(data() + size(), buf, sz);
+        Traits::assign(*(data() + size() + sz), CharT());
+        set_size_(size() + sz);
+
+        Instrumentation::on_copy(sz * sizeof(CharT));
 
         return *this;
     }
@@ -183,6 +478,13 @@ public:
         return append(rhs.data(), rhs.size());
     }
 
+    template<typename T, if_view_like_<T> = 0>
+    BasicString& append(const T& str)
+    {
+        view_type sv = str;
+        return append(sv.data(), sv.size());
+    }
+
     BasicString& append(CharT ch)
     {
         return append(std::addressof(ch), 1u);
@@ -197,12 +499,12 @@ public:
 
     size_t size() const
     {
-        return m_size;
+        return m_size & ~long_flag_;
     }
 
     size_t capacity() const
     {
-        return m_capacity;
+        return is_long_() ? m_storage.buf.heap.capacity : local_capacity_;
     }
 
     size_t max_size() const
@@ -219,12 +521,12 @@ public:
 
     const CharT* data() const
     {
-        return m_data != nullptr ? m_data : ptr_to_null();
+        return is_long_() ? m_storage.buf.heap.data : local_data_();
     }
 
     CharT* data()
     {
-        return m_data != nullptr ? m_data : ptr_to_null();
+        return is_long_() ? m_storage.buf.heap.data : local_data_();
     }
 
     const CharT* c_str() const
@@ -232,18 +534,23 @@ public:
         return data();
     }
 
+    operator view_type() const noexcept
+    {
+        return view_type{data(), size()};
+    }
+
     const CharT& operator[](size_t index) const
     {
         assert(index < size());
 
-        return m_data[index];
+        return data()[index];
     }
 
     CharT& operator[](size_t index)
     {
         assert(index < size());
 
-        return m_data[index];
+        return data()[index];
     }
 
     const CharT& at(size_t index) const
@@ -251,7 +558,7 @@ public:
         if(index >= size())
             throw std::out_of_range{"bad index"};
 
-        return m_data[index];
+        return data()[index];
     }
 
     CharT& at(size_t index)
@@ -259,7 +566,7 @@ public:
         if(index >= size())
             throw std::out_of_range{"bad index"};
 
-        return m_data[index];
+        return data()[index];
     }
 
     const CharT& front() const
@@ -289,7 +596,29 @@ public:
         if(index >= size())
             throw std::out_of_range{"bad index"};
 
-        return BasicString{data() + index, std::min(size() - index, count)};
+        return BasicString{data() + index, std::min(size() - index, count),
+                           alloc_traits_::select_on_container_copy_construction(get_allocator_())};
+    }
+
+    // the fields between delimiters, as views; see BasicStringView::split()
+    typename view_type::split_range split(view_type delims) const
+    {
+        return view_type(*this).split(delims);
+    }
+
+    template<typename Container>
+    Container& split_into(Container& out, view_type delims) const
+    {
+        return view_type(*this).split_into(out, delims);
+    }
+
+    // as substr(), but without a copy; the view is good until this changes
+    view_type substr_view(size_t index = 0, size_t count = npos) const
+    {
+        if(index >= size())
+            throw std::out_of_range{"bad index"};
+
+        return view_type{data() + index, std::min(size() - index, count)};
     }
 
     BasicString& replace(size_t index, size_t count, const CharT* buf, size_t sz)
@@ -305,14 +634,12 @@ public:
 
         auto replace_exsafe_ = [&]()
         {
-            using std::swap;
-
-            BasicString tmp{reserve_t{new_size}};
+            BasicString tmp{reserve_t{new_size}, get_allocator_()};
             tmp.append(data(), index);
             tmp.append(buf, sz);
             tmp.append(data() + index + eff_count, size() - index - eff_count);
 
-            swap(*this, tmp);
+            swap_buffers_(tmp);
         };
 
         if constexpr (!std::is_nothrow_copy_assignable_v<CharT>
@@ -325,45 +652,34 @@ public:
         {
             replace_exsafe_();
         }
+        else if(new_size != size() && sz != 0u && points_into_(buf))
+        {
+            replace_exsafe_(); // the tail is about to move under buf
+        }
         else
         {
-            if(new_size < size())
+            if(new_size != size())
             {
-                // slide left
-                std::move(
+                // slide the tail left (shrinking) or right (growing),
+                // the ranges may overlap either way
+                Traits::move(
+                        data() + index + sz,
                         data() + index + eff_count,
-                        data() + size(),
-                        data() + index + sz
+                        size() - index - eff_count
                     );
 
+                Instrumentation::on_copy((size() - index - eff_count) * sizeof(CharT));
+
                 // std::destroy(data() + new_size, data() + size());
 
-                *(data() + new_size) = *ptr_to_null(); // std::uninitialized_copy
+                Traits::assign(*(data() + new_size), CharT());
             }
-            else if(new_size > size())
-            {
-                size_t excess_size = new_size - size();
-
-                // slide right (part1: uninitialized section)
-                std::copy(
-                        std::reverse_iterator<CharT*>(data() + size()),
-                        std::reverse_iterator<CharT*>(data() + size() - excess_size),
-                        std::reverse_iterator<CharT*>(data() + new_size)
-                    ); // std::uninitialized_copy
-
-                // slide right (part2: overwrite section)
-                std::move(
-                        std::reverse_iterator<CharT*>(data() + size() - excess_size),
-                        std::reverse_iterator<CharT*>(data() + index + eff_count),
-                        std::reverse_iterator<CharT*>(data() + size())
-                    );
 
-                *(data() + new_size) = *ptr_to_null(); // std::uninitialized_copy
-            }
+            // do the remaining replacement in-place; buf may be a part of this string
+            Traits::move(data() + index, buf, sz);
+            set_size_(new_size);
 
-            // do the remaining replacement in-place
-            std::copy(buf, buf + sz, data() + index); // std::copy assign
-            m_size = new_size;
+            Instrumentation::on_copy(sz * sizeof(CharT));
         }
 
         return *this;
@@ -374,9 +690,54 @@ public:
         return replace(index, count, buf, strlen_(buf));
     }
 
+    template<typename T, if_view_like_<T> = 0>
+    BasicString& replace(size_t index, size_t count, const T& str)
+    {
+        view_type sv = str;
+        return replace(index, count, sv.data(), sv.size());
+    }
+
+    //
+    // Replaces every occurrence of pattern, left to right and without
+    // overlaps. The occurrences are all found first, so the result is put
+    // together with one allocation at most, and every char is copied once.
+    // Returns the number of replacements; an empty pattern has none.
+    //
+    size_t replace_all(view_type pattern, view_type replacement)
+    {
+        std::vector<edit_t> edits;
+        if(!pattern.empty())
+        {
+            for(size_t i = find(pattern.data(), 0u, pattern.size()); i != npos;
+                       i = find(pattern.data(), i + pattern.size(), pattern.size()))
+            {
+                edits.push_back(edit_t{i, pattern.size(), replacement});
+            }
+        }
+
+        apply_edits_(edits);
+        return edits.size();
+    }
+
+    //
+    // The same, for (pattern, replacement) pairs all at once. Where patterns
+    // compete, the leftmost match wins, and of those at the same place, the
+    // pattern listed first. Replacements are not searched again.
+    //
+    size_t replace_all(std::initializer_list<std::pair<view_type, view_type>> pairs)
+    {
+        return replace_all_pairs_(pairs.begin(), pairs.end());
+    }
+
+    template<typename Range>
+    size_t replace_all(const Range& pairs)
+    {
+        return replace_all_pairs_(std::begin(pairs), std::end(pairs));
+    }
+
     BasicString& erase(size_t index, size_t count = npos)
     {
-        return replace(index, count, "");
+        return replace(index, count, data(), 0u);
     }
 
     BasicString& insert(size_t index, const CharT* buf, size_t sz)
@@ -394,121 +755,1300 @@ public:
         return insert(index, str.data(), str.size());
     }
 
+    template<typename T, if_view_like_<T> = 0>
+    BasicString& insert(size_t index, const T& str)
+    {
+        view_type sv = str;
+        return insert(index, sv.data(), sv.size());
+    }
+
     size_t find(const CharT* buf, size_t index, size_t sz) const
     {
-        // move to trait
+        return find_(data(), size(), buf, index, sz);
+    }
 
-        if(sz > size() || index > size() - sz)
-            return npos;
+    size_t find(const CharT* buf, size_t index = 0) const
+    {
+        return find(buf, index, strlen_(buf));
+    }
 
-        const CharT* beg = data() + index;
-        const CharT* end = data() + size() - sz;
-        while(true)
-        {
-            bool match = true;
-            for(size_t i = 0u; i < sz; ++i)
-            {
-                if (!std::equal_to{}(*(beg + i), *(buf + i))) // move to trait
-                {
-                    match = false;
-                    break;
-                }
-            }
+    size_t find(const BasicString& str, size_t index = 0) const
+    {
+        return find(str.data(), index, str.size());
+    }
 
-            if(match)
-            {
-                return beg - data();
-            }
+    template<typename T, if_view_like_<T> = 0>
+    size_t find(const T& str, size_t index = 0) const
+    {
+        view_type sv = str;
+        return find(sv.data(), index, sv.size());
+    }
 
-            if(beg++ == end)
-                break;
-        }
+    // <0, 0 or >0, as this orders before, equal to or after rhs
+    int compare(view_type rhs) const
+    {
+        return compare_(*this, rhs);
+    }
 
-        return npos;
+    // of substr(index, count) with rhs, without making the substring
+    int compare(size_t index, size_t count, view_type rhs) const
+    {
+        return compare_(view_type(*this).substr(index, count), rhs);
     }
 
-    size_t find(const CharT* buf, size_t index = 0) const
+    //
+    // Comparisons with strings, views and C strings, as by compare(); equality
+    // looks at the sizes first.
+    //
+    friend bool operator==(const BasicString& lhs, const BasicString& rhs)
     {
-        return find(buf, index, strlen_(buf));
+        return equal_(lhs, rhs);
     }
 
-    size_t find(const BasicString& str, size_t index = 0) const
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator==(const BasicString& lhs, const T& rhs)
     {
-        return find(str.data(), index, str.size());
+        return equal_(lhs, rhs);
     }
 
-    //////////////////////////
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator==(const T& lhs, const BasicString& rhs)
+    {
+        return equal_(lhs, rhs);
+    }
 
-    // TODO: iterators, const_iterators
+    friend bool operator!=(const BasicString& lhs, const BasicString& rhs)
+    {
+        return !equal_(lhs, rhs);
+    }
 
-private:
-    struct reserve_t
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator!=(const BasicString& lhs, const T& rhs)
     {
-        explicit reserve_t(size_t value)
-            : value(value)
-        {
-        }
+        return !equal_(lhs, rhs);
+    }
 
-        size_t value;
-    };
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator!=(const T& lhs, const BasicString& rhs)
+    {
+        return !equal_(lhs, rhs);
+    }
 
-    explicit BasicString(reserve_t rz)
+    friend bool operator<(const BasicString& lhs, const BasicString& rhs)
     {
-        m_data = new CharT[rz.value + 1]; // TODO: use allocator
-        m_capacity = rz.value;
+        return compare_(lhs, rhs) < 0;
     }
 
-    size_t spare_capacity_() const
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator<(const BasicString& lhs, const T& rhs)
     {
-        return capacity() - size();
+        return compare_(lhs, rhs) < 0;
     }
 
-    void set_capacity_exsafe_(size_t new_cap)
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator<(const T& lhs, const BasicString& rhs)
     {
-        if(new_cap > max_size())
-            throw std::length_error("size too big");
+        return compare_(lhs, rhs) < 0;
+    }
 
-        using std::swap;
+    friend bool operator<=(const BasicString& lhs, const BasicString& rhs)
+    {
+        return compare_(lhs, rhs) <= 0;
+    }
 
-        BasicString tmp{reserve_t{new_cap}};
-        tmp.append(*this);
-        swap(tmp, *this);
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator<=(const BasicString& lhs, const T& rhs)
+    {
+        return compare_(lhs, rhs) <= 0;
     }
 
-    static CharT* ptr_to_null()
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator<=(const T& lhs, const BasicString& rhs)
     {
-        static CharT ch = CharT{}; // TODO: use trait
-        return std::addressof(ch);
+        return compare_(lhs, rhs) <= 0;
     }
 
-    static size_t strlen_(const CharT* buf)
+    friend bool operator>(const BasicString& lhs, const BasicString& rhs)
     {
-        const CharT* e = buf;
-        while(*e != *ptr_to_null()) ++e;
-        return e - buf;
+        return compare_(lhs, rhs) > 0;
     }
 
-private:
-    CharT* m_data = nullptr;
-    size_t m_size = 0;
-    size_t m_capacity = 0;
-};
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator>(const BasicString& lhs, const T& rhs)
+    {
+        return compare_(lhs, rhs) > 0;
+    }
 
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator>(const T& lhs, const BasicString& rhs)
+    {
+        return compare_(lhs, rhs) > 0;
+    }
 
-#include <ostream>
+    friend bool operator>=(const BasicString& lhs, const BasicString& rhs)
+    {
+        return compare_(lhs, rhs) >= 0;
+    }
 
-template<typename CharT>
-std::ostream& operator<<(std::ostream& os, const BasicString<CharT>& rhs)
-{
-    for(size_t i = 0; i < rhs.size(); ++i)
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator>=(const BasicString& lhs, const T& rhs)
     {
-        os << rhs[i];
+        return compare_(lhs, rhs) >= 0;
     }
 
-    return os;
-}
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator>=(const T& lhs, const BasicString& rhs)
+    {
+        return compare_(lhs, rhs) >= 0;
+    }
 
-// TODO: operator+
+    class searcher;
 
-using String = BasicString<char>;
-using wString = BasicString<wchar_t>;
+    size_t find(const searcher& s, size_t index = 0) const
+    {
+        if(index > size())
+            return npos;
+
+        size_t r = s.search(data() + index, size() - index);
+        return r == npos ? npos : index + r;
+    }
+
+    //////////////////////////
+
+    // TODO: iterators, const_iterators
+
+private:
+    // count chars at pos are to be replaced with the chars of with
+    struct edit_t
+    {
+        size_t pos;
+        size_t count;
+        view_type with;
+    };
+
+    template<typename It>
+    size_t replace_all_pairs_(It first, It last)
+    {
+        std::vector<view_type> patterns;
+        std::vector<view_type> replacements;
+        for(; first != last; ++first)
+        {
+            patterns.push_back(view_type(first->first));
+            replacements.push_back(view_type(first->second));
+        }
+
+        // the next match of each pattern, at or after the cursor
+        std::vector<size_t> next(patterns.size(), npos);
+        for(size_t j = 0u; j < patterns.size(); ++j)
+        {
+            if(!patterns[j].empty())
+                next[j] = find(patterns[j].data(), 0u, patterns[j].size());
+        }
+
+        std::vector<edit_t> edits;
+        size_t cursor = 0u;
+        while(true)
+        {
+            size_t best = npos;
+            for(size_t j = 0u; j < patterns.size(); ++j)
+            {
+                if(next[j] != npos && next[j] < cursor)
+                    next[j] = find(patterns[j].data(), cursor, patterns[j].size());
+
+                if(next[j] != npos && (best == npos || next[j] < next[best]))
+                    best = j;
+            }
+
+            if(best == npos)
+                break;
+
+            edits.push_back(edit_t{next[best], patterns[best].size(), replacements[best]});
+            cursor = next[best] + patterns[best].size();
+        }
+
+        apply_edits_(edits);
+        return edits.size();
+    }
+
+    // applies edits, in order and not overlapping, with the strong guarantee
+    void apply_edits_(const std::vector<edit_t>& edits)
+    {
+        if(edits.empty())
+            return;
+
+        size_t new_size = size();
+        bool shrinks = true;
+        bool grows = true;
+        bool aliased = false;
+        for(const edit_t& e : edits)
+        {
+            new_size = add_sat_(new_size - e.count, e.with.size());
+            shrinks = shrinks && e.with.size() <= e.count;
+            grows = grows && e.with.size() >= e.count;
+
+            std::less<const CharT*> before;
+            aliased = aliased || (!before(e.with.data(), data()) && before(e.with.data(), data() + capacity() + 1));
+        }
+
+        if(new_size > max_size())
+            throw std::length_error("size too big");
+
+        constexpr bool nothrow = std::is_nothrow_copy_assignable_v<CharT>
+                              && std::is_nothrow_move_assignable_v<CharT>
+                              && std::is_nothrow_constructible_v<CharT>;
+
+        if(!nothrow || new_size > capacity() || aliased || !(shrinks || grows))
+        {
+            BasicString tmp{reserve_t{new_size}, get_allocator_()};
+
+            size_t src = 0u;
+            for(const edit_t& e : edits)
+            {
+                tmp.append(data() + src, e.pos - src);
+                tmp.append(e.with.data(), e.with.size());
+                src = e.pos + e.count;
+            }
+            tmp.append(data() + src, size() - src);
+
+            swap_buffers_(tmp);
+            return;
+        }
+
+        // in place: front to back when nothing grows, so that every char is
+        // read before it is overwritten, and back to front when nothing shrinks
+        CharT* p = data();
+        if(shrinks)
+        {
+            size_t dst = edits.front().pos;
+            for(size_t k = 0u; k < edits.size(); ++k)
+            {
+                const edit_t& e = edits[k];
+                Traits::copy(p + dst, e.with.data(), e.with.size());
+                dst += e.with.size();
+
+                size_t src = e.pos + e.count;
+                size_t end = k + 1 < edits.size() ? edits[k + 1].pos : size();
+                Traits::move(p + dst, p + src, end - src);
+                dst += end - src;
+            }
+        }
+        else
+        {
+            size_t src_end = size();
+            size_t dst_end = new_size;
+            for(size_t k = edits.size(); k-- != 0u; )
+            {
+                const edit_t& e = edits[k];
+                size_t src = e.pos + e.count;
+                dst_end -= src_end - src;
+                Traits::move(p + dst_end, p + src, src_end - src);
+
+                dst_end -= e.with.size();
+                Traits::copy(p + dst_end, e.with.data(), e.with.size());
+                src_end = e.pos;
+            }
+        }
+
+        Instrumentation::on_copy((new_size - edits.front().pos) * sizeof(CharT));
+
+        // std::destroy(data() + new_size, data() + size());
+        Traits::assign(*(p + new_size), CharT());
+        set_size_(new_size);
+    }
+
+    struct reserve_t
+    {
+        explicit reserve_t(size_t value)
+            : value(value)
+        {
+        }
+
+        size_t value;
+    };
+
+    BasicString(reserve_t rz, const Allocator& alloc)
+        : BasicString(alloc)
+    {
+        if(rz.value > local_capacity_)
+        {
+            m_storage.buf.heap = heap_t{allocate_(get_allocator_(), rz.value), rz.value};
+            m_size = long_flag_;
+
+            Traits::assign(*m_storage.buf.heap.data, CharT());
+        }
+    }
+
+    Allocator& get_allocator_()
+    {
+        return m_storage;
+    }
+
+    const Allocator& get_allocator_() const
+    {
+        return m_storage;
+    }
+
+    void swap_buffers_(BasicString& rhs) noexcept
+    {
+        using std::swap;
+
+        swap(m_size, rhs.m_size);
+        swap(m_storage.buf, rhs.m_storage.buf);
+    }
+
+    //
+    // Integral chars with the standard traits are equal exactly when their
+    // bytes are, so equality is a memcmp. Order is too for single bytes;
+    // wider chars are ordered at the first differing byte, which the simd
+    // kernel finds, as their bytes do not sort like the chars themselves.
+    //
+    static constexpr bool memcmp_equal_ = std::is_integral_v<CharT>
+                                       && std::is_same_v<Traits, std::char_traits<CharT>>;
+
+    static bool equal_(view_type lhs, view_type rhs)
+    {
+        if(lhs.size() != rhs.size())
+            return false;
+
+        if constexpr(memcmp_equal_)
+            return lhs.size() == 0u || std::memcmp(lhs.data(), rhs.data(), lhs.size() * sizeof(CharT)) == 0;
+        else
+            return Traits::compare(lhs.data(), rhs.data(), lhs.size()) == 0;
+    }
+
+    static int compare_(view_type lhs, view_type rhs)
+    {
+        size_t n = std::min(lhs.size(), rhs.size());
+
+        int r = 0;
+        if constexpr(memcmp_equal_ && sizeof(CharT) > 1u)
+        {
+            size_t i = simd::mismatch(reinterpret_cast<const char*>(lhs.data()),
+                                      reinterpret_cast<const char*>(rhs.data()), n * sizeof(CharT));
+            if(i != simd::npos)
+            {
+                i /= sizeof(CharT);
+                r = Traits::lt(lhs[i], rhs[i]) ? -1 : 1;
+            }
+        }
+        else if(n != 0u)
+        {
+            r = Traits::compare(lhs.data(), rhs.data(), n);
+        }
+
+        if(r != 0)
+            return r;
+
+        return lhs.size() < rhs.size() ? -1 : (lhs.size() > rhs.size() ? 1 : 0);
+    }
+
+    // allocates and constructs cap + 1 elements (the extra one for the null)
+    static CharT* allocate_(Allocator& alloc, size_t cap)
+    {
+        CharT* p = alloc_traits_::allocate(alloc, cap + 1);
+
+        if constexpr(!std::is_trivial_v<CharT>)
+        {
+            size_t i = 0u;
+            try
+            {
+                for(; i != cap + 1; ++i)
+                    alloc_traits_::construct(alloc, p + i);
+            }
+            catch(...)
+            {
+                while(i != 0u)
+                    alloc_traits_::destroy(alloc, p + --i);
+                alloc_traits_::deallocate(alloc, p, cap + 1);
+                throw;
+            }
+        }
+
+        Instrumentation::on_allocate((cap + 1) * sizeof(CharT));
+        return p;
+    }
+
+    static void deallocate_(Allocator& alloc, CharT* p, size_t cap)
+    {
+        if constexpr(!std::is_trivial_v<CharT>)
+        {
+            for(size_t i = 0u; i != cap + 1; ++i)
+                alloc_traits_::destroy(alloc, p + i);
+        }
+
+        alloc_traits_::deallocate(alloc, p, cap + 1);
+
+        Instrumentation::on_deallocate((cap + 1) * sizeof(CharT));
+    }
+
+    // which searches and compares its own storage with find_() and compare_()
+    template<typename, typename>
+    friend class BasicMappedString;
+
+    //
+    // Hand-over of the heap buffer to and from the buffer-sharing types
+    // (see SharedBasicString). The buffer is one allocation of capacity + 1
+    // elements, from an allocator equal to ours. For the instrumentation it
+    // counts as allocated when adopted, and as freed when released.
+    //
+    template<typename, typename, typename>
+    friend class SharedBasicString;
+
+    void adopt_heap_(CharT* p, size_t sz, size_t cap) noexcept
+    {
+        assert(!is_long_());
+
+        m_storage.buf.heap = heap_t{p, cap};
+        m_size = sz | long_flag_;
+
+        Instrumentation::on_allocate((cap + 1) * sizeof(CharT));
+    }
+
+    CharT* release_heap_() noexcept
+    {
+        assert(is_long_());
+
+        CharT* p = m_storage.buf.heap.data;
+        Instrumentation::on_deallocate((m_storage.buf.heap.capacity + 1) * sizeof(CharT));
+
+        m_storage.buf = buffer_t{};
+        m_size = 0u;
+        return p;
+    }
+
+    // whether p is in [data(), data() + size())
+    bool points_into_(const CharT* p) const
+    {
+        std::less<const CharT*> before;
+        return !before(p, data()) && before(p, data() + size());
+    }
+
+    bool is_long_() const
+    {
+        return (m_size & long_flag_) != 0u;
+    }
+
+    void set_size_(size_t new_size)
+    {
+        m_size = new_size | (m_size & long_flag_);
+    }
+
+    const CharT* local_data_() const
+    {
+        if constexpr(sso_enabled_)
+            return m_storage.buf.local;
+        else
+            return ptr_to_null();
+    }
+
+    CharT* local_data_()
+    {
+        if constexpr(sso_enabled_)
+            return m_storage.buf.local;
+        else
+            return ptr_to_null();
+    }
+
+    size_t spare_capacity_() const
+    {
+        return capacity() - size();
+    }
+
+    void grow_for_append_(size_t sz)
+    {
+        if(sz > spare_capacity_())
+            set_capacity_exsafe_(grown_capacity_(sz));
+    }
+
+    // the capacity the growth policy gives for sz more elements
+    size_t grown_capacity_(size_t sz) const
+    {
+        size_t min_cap = add_sat_(size(), sz);
+        size_t new_cap = Growth::template next_capacity<CharT>(size(), min_cap);
+        assert(new_cap >= min_cap);
+
+        // what the policy asks for above max_size() is given up, if enough remains
+        if(new_cap > max_size() && min_cap <= max_size())
+            new_cap = max_size();
+
+        return new_cap;
+    }
+
+    // moves to a buffer of new_cap, and appends extra there, which may be in the old one
+    void set_capacity_exsafe_(size_t new_cap, view_type extra = view_type{})
+    {
+        if(new_cap > max_size())
+            throw std::length_error("size too big");
+
+        if(new_cap > capacity())
+            Instrumentation::on_grow((capacity() + 1) * sizeof(CharT), (new_cap + 1) * sizeof(CharT));
+
+        BasicString tmp{reserve_t{new_cap}, get_allocator_()};
+        tmp.append(*this);
+        tmp.append(extra.data(), extra.size());
+        swap_buffers_(tmp);
+    }
+
+    // chars that compare equal exactly when their bytes do
+    static constexpr bool bytewise_ = sizeof(CharT) == 1u
+                                   && std::is_integral_v<CharT>
+                                   && std::is_same_v<Traits, std::char_traits<CharT>>;
+
+    // the search behind find(), over any hay[0, n)
+    static size_t find_(const CharT* hay, size_t n, const CharT* buf, size_t index, size_t sz)
+    {
+        if(sz > n || index > n - sz)
+            return npos;
+
+        if constexpr(bytewise_)
+        {
+            size_t r = simd::find(reinterpret_cast<const char*>(hay + index), n - index,
+                                  reinterpret_cast<const char*>(buf), sz);
+
+            return r == simd::npos ? npos : index + r;
+        }
+
+        if(sz == 0u)
+            return index;
+
+        const CharT* beg = hay + index;
+        const CharT* end = hay + n - sz + 1; // one past the last candidate
+        while((beg = Traits::find(beg, end - beg, *buf)) != nullptr)
+        {
+            if(Traits::compare(beg + 1, buf + 1, sz - 1) == 0)
+                return beg - hay;
+
+            ++beg;
+        }
+
+        return npos;
+    }
+
+    static CharT* ptr_to_null()
+    {
+        static CharT ch = CharT();
+        return std::addressof(ch);
+    }
+
+    static size_t strlen_(const CharT* buf)
+    {
+        return Traits::length(buf);
+    }
+
+private:
+    //
+    // Short strings live inline, in the bytes that otherwise hold the heap
+    // pointer and capacity, so the object stays three words in size.
+    // max_size() keeps the top bit of the size free; it is used as the
+    // long (heap-allocated) mode flag. Inline storage is only used for
+    // trivial CharT, as those can be bitwise moved around in a union.
+    //
+    struct heap_t
+    {
+        CharT* data;
+        size_t capacity;
+    };
+
+    static constexpr bool sso_enabled_ = std::is_trivial_v<CharT>
+                                      && sizeof(heap_t) / sizeof(CharT) >= 2u;
+
+    static constexpr size_t local_capacity_ = sso_enabled_ ? sizeof(heap_t) / sizeof(CharT) - 1u : 0u;
+
+    static constexpr size_t long_flag_ = ~(std::numeric_limits<size_t>::max() >> 1);
+
+    using local_t = std::conditional_t<sso_enabled_, CharT, unsigned char>;
+
+    union buffer_t
+    {
+        local_t local[local_capacity_ + 1];
+        heap_t heap;
+    };
+
+    // derives from the allocator, so that stateless ones take no space
+    struct storage_t : Allocator
+    {
+        storage_t() = default;
+
+        explicit storage_t(const Allocator& alloc) noexcept
+            : Allocator(alloc)
+        {
+        }
+
+        buffer_t buf = {};
+    };
+
+private:
+    storage_t m_storage;
+    size_t m_size = 0;
+};
+
+//
+// A needle preprocessed once, to be looked up in any number of haystacks
+// in worst-case linear time with the Two-Way algorithm (Crochemore-Perrin).
+// For long needles of bytes, a Horspool style skip table on the last
+// character of the window is consulted first, which lets typical searches
+// skip most of the haystack (as in glibc's memmem).
+//
+template<typename CharT, typename Traits, typename Allocator, typename Instrumentation, typename Growth>
+class BasicString<CharT, Traits, Allocator, Instrumentation, Growth>::searcher
+{
+public:
+    searcher(const CharT* buf, size_t sz, const Allocator& alloc = Allocator())
+        : m_needle(buf, sz, alloc)
+    {
+        init_();
+    }
+
+    explicit searcher(const BasicString& needle)
+        : searcher(needle.data(), needle.size(), needle.get_allocator())
+    {
+    }
+
+    const BasicString& needle() const
+    {
+        return m_needle;
+    }
+
+    // returns the offset of the first match in hay[0, n), or npos
+    size_t search(const CharT* hay, size_t n) const
+    {
+        const CharT* x = m_needle.data();
+        const size_t m = m_needle.size();
+
+        if(m == 0u) return 0u;
+        if(m > n) return npos;
+
+        // with the skip table, the last character is already known to match
+        const size_t right_end = m_use_shift ? m - 1 : m;
+
+        size_t memory = 0u; // prefix of the window known to match (periodic needles)
+        size_t j = 0u;
+        while(j <= n - m)
+        {
+            if constexpr(bytewise_)
+            {
+                if(m_use_shift)
+                {
+                    size_t shift = m_shift[static_cast<unsigned char>(hay[j + m - 1])];
+                    if(shift != 0u)
+                    {
+                        if(memory != 0u && shift < m_period)
+                            shift = m - m_period;
+
+                        memory = 0u;
+                        j += shift;
+                        continue;
+                    }
+                }
+            }
+
+            // right half, left to right
+            size_t i = std::max(m_suffix, memory);
+            while(i < right_end && Traits::eq(x[i], hay[j + i]))
+                ++i;
+
+            if(i < right_end)
+            {
+                j += i - m_suffix + 1;
+                memory = 0u;
+                continue;
+            }
+
+            // left half, right to left
+            i = m_suffix;
+            while(i > memory && Traits::eq(x[i - 1], hay[j + i - 1]))
+                --i;
+
+            if(i <= memory)
+                return j;
+
+            j += m_period;
+            if(m_periodic)
+                memory = m - m_period;
+        }
+
+        return npos;
+    }
+
+private:
+    static constexpr size_t long_needle_ = 32u;
+
+    void init_()
+    {
+        const CharT* x = m_needle.data();
+        const size_t m = m_needle.size();
+
+        if(m == 0u)
+            return;
+
+        // critical factorization x = x[0, suffix) x[suffix, m)
+        if(m < 3u)
+        {
+            m_suffix = m - 1;
+            m_period = 1u;
+        }
+        else
+        {
+            size_t period = 0u;
+            size_t period_rev = 0u;
+            size_t suffix = maximal_suffix_(x, m, false, period);
+            size_t suffix_rev = maximal_suffix_(x, m, true, period_rev);
+
+            m_suffix = suffix_rev < suffix ? suffix : suffix_rev;
+            m_period = suffix_rev < suffix ? period : period_rev;
+        }
+
+        m_periodic = Traits::compare(x, x + m_period, m_suffix) == 0;
+        if(!m_periodic)
+        {
+            // the halves differ, so any mismatch allows a maximal shift
+            m_period = std::max(m_suffix, m - m_suffix) + 1;
+        }
+
+        if constexpr(bytewise_)
+        {
+            m_use_shift = m >= long_needle_;
+            if(m_use_shift)
+            {
+                std::fill(std::begin(m_shift), std::end(m_shift), m);
+                for(size_t i = 0u; i < m; ++i)
+                    m_shift[static_cast<unsigned char>(x[i])] = m - i - 1;
+            }
+        }
+    }
+
+    // start of the maximal suffix of x (for the reversed order, if asked),
+    // and its period. npos + 1 wraps to 0, which is what makes it work.
+    static size_t maximal_suffix_(const CharT* x, size_t m, bool reversed, size_t& period)
+    {
+        size_t ms = npos;
+        size_t j = 0u;
+        size_t k = 1u;
+        size_t p = 1u;
+
+        while(j + k < m)
+        {
+            const CharT& a = x[j + k];
+            const CharT& b = x[ms + k];
+
+            if(reversed ? Traits::lt(b, a) : Traits::lt(a, b))
+            {
+                j += k;
+                k = 1u;
+                p = j - ms;
+            }
+            else if(Traits::eq(a, b))
+            {
+                if(k != p)
+                {
+                    ++k;
+                }
+                else
+                {
+                    j += p;
+                    k = 1u;
+                }
+            }
+            else
+            {
+                ms = j++;
+                k = p = 1u;
+            }
+        }
+
+        period = p;
+        return ms + 1;
+    }
+
+private:
+    BasicString m_needle;
+    size_t m_suffix = 0u;
+    size_t m_period = 0u;
+    bool m_periodic = false;
+    bool m_use_shift = false;
+    size_t m_shift[bytewise_ ? 256 : 1] = {};
+};
+
+
+#include <istream>
+#include <locale>
+#include <ostream>
+
+// formatted, as for views: padded to the width of the stream, and written in one go
+template<typename CharT, typename Traits, typename Allocator, typename Instrumentation, typename Growth>
+std::basic_ostream<CharT>& operator<<(std::basic_ostream<CharT>& os, const BasicString<CharT, Traits, Allocator, Instrumentation, Growth>& rhs)
+{
+    return os << BasicStringView<CharT, Traits>(rhs);
+}
+
+//
+// Reads chars from the buffer of the stream into the spare capacity of str,
+// which is grown by its growth policy whenever it runs out, until stop(ch)
+// says to, or max chars have been stored. Returns the number taken out of
+// the stream, and the state to set on it.
+//
+// What the buffer throws sets badbit, and is rethrown if the stream asks
+// for exceptions on badbit, as the standard extractors do.
+//
+template<typename String, typename Stop>
+std::pair<size_t, std::ios_base::iostate> read_into_(std::basic_istream<typename String::value_type>& is,
+                                                     String& str, size_t max, Stop stop)
+{
+    using CharT = typename String::value_type;
+    using traits = std::char_traits<CharT>;
+
+    std::basic_streambuf<CharT>* buf = is.rdbuf();
+    str.clear();
+
+    size_t n = 0u;
+    size_t taken = 0u;
+    std::ios_base::iostate state = std::ios_base::goodbit;
+    try
+    {
+        for(auto c = buf->sgetc(); ; c = buf->snextc())
+        {
+            if(traits::eq_int_type(c, traits::eof()))
+            {
+                state |= std::ios_base::eofbit;
+                break;
+            }
+
+            CharT ch = traits::to_char_type(c);
+            int what = stop(ch);
+            if(what != 0)
+            {
+                if(what > 0) // taken out, but not stored
+                {
+                    buf->sbumpc();
+                    ++taken;
+                }
+
+                break;
+            }
+
+            if(n == max)
+            {
+                state |= std::ios_base::failbit;
+                break;
+            }
+
+            if(n == str.size())
+            {
+                if(str.size() == str.capacity())
+                    str.append_uninitialized(1u);
+
+                str.append_uninitialized(str.capacity() - str.size());
+            }
+
+            str.data()[n++] = ch;
+            ++taken;
+        }
+    }
+    catch(...)
+    {
+        if(is.exceptions() & std::ios_base::badbit)
+        {
+            str.resize(n);
+
+            try
+            {
+                is.setstate(std::ios_base::badbit); // throws ios_base::failure, not the one to pass on
+            }
+            catch(const std::ios_base::failure&)
+            {
+            }
+
+            throw;
+        }
+
+        state |= std::ios_base::badbit;
+    }
+
+    str.resize(n);
+
+    return {taken, state};
+}
+
+// a whitespace delimited word, of at most width() chars if that is set
+template<typename CharT, typename Traits, typename Allocator, typename Instrumentation, typename Growth>
+std::basic_istream<CharT>& operator>>(std::basic_istream<CharT>& is, BasicString<CharT, Traits, Allocator, Instrumentation, Growth>& rhs)
+{
+    typename std::basic_istream<CharT>::sentry ok{is}; // skips the leading whitespace
+    if(!ok)
+        return is;
+
+    const std::ctype<CharT>& ctype = std::use_facet<std::ctype<CharT>>(is.getloc());
+
+    size_t max = is.width() > 0 ? static_cast<size_t>(is.width()) : rhs.max_size();
+    auto [taken, state] = read_into_(is, rhs, max, [&ctype](CharT ch)
+    {
+        return ctype.is(std::ctype_base::space, ch) ? -1 : 0;
+    });
+
+    // a full width is not an error
+    if(taken == max)
+        state &= ~std::ios_base::failbit;
+
+    is.width(0);
+    if(taken == 0u)
+        state |= std::ios_base::failbit;
+
+    is.setstate(state);
+    return is;
+}
+
+// the chars up to delim, which is taken out of the stream but not stored
+template<typename CharT, typename Traits, typename Allocator, typename Instrumentation, typename Growth>
+std::basic_istream<CharT>& getline(std::basic_istream<CharT>& is, BasicString<CharT, Traits, Allocator, Instrumentation, Growth>& str, CharT delim)
+{
+    typename std::basic_istream<CharT>::sentry ok{is, true};
+    if(!ok)
+        return is;
+
+    auto [taken, state] = read_into_(is, str, str.max_size(), [delim](CharT ch)
+    {
+        return std::char_traits<CharT>::eq(ch, delim) ? 1 : 0;
+    });
+
+    if(taken == 0u)
+        state |= std::ios_base::failbit;
+
+    is.setstate(state);
+    return is;
+}
+
+template<typename CharT, typename Traits, typename Allocator, typename Instrumentation, typename Growth>
+std::basic_istream<CharT>& getline(std::basic_istream<CharT>& is, BasicString<CharT, Traits, Allocator, Instrumentation, Growth>& str)
+{
+    return getline(is, str, is.widen('\n'));
+}
+
+//
+// operator+ builds a lazy expression instead of a string: the pieces are
+// only copied when the expression is converted to a string, after the
+// total length is known, with one allocation and one pass of copies.
+//
+// Like any view, an expression refers to the (lvalue) strings it was built
+// from, so it must not outlive them. The result gets the allocator of the
+// leftmost string operand, as std::basic_string's operator+ would give it.
+// Where an operand is an rvalue string, operator+ is eager instead, and
+// reuses that operand's buffer.
+//
+template<typename String>
+struct ConcatSpan_
+{
+    using value_type = typename String::value_type;
+    using traits_type = typename String::traits_type;
+
+    size_t size() const
+    {
+        return length;
+    }
+
+    const String* origin() const
+    {
+        return str;
+    }
+
+    // whether the chars are in the buffer of s
+    bool points_into(const String& s) const
+    {
+        std::less<const value_type*> before;
+        return !before(data, s.data()) && before(data, s.data() + s.size() + 1);
+    }
+
+    value_type* copy_to(value_type* dst) const
+    {
+        traits_type::copy(dst, data, length);
+        return dst + length;
+    }
+
+    const value_type* data;
+    size_t length;
+    const String* str; // null for C strings
+};
+
+template<typename String>
+struct ConcatChar_
+{
+    using value_type = typename String::value_type;
+    using traits_type = typename String::traits_type;
+
+    size_t size() const
+    {
+        return 1u;
+    }
+
+    const String* origin() const
+    {
+        return nullptr;
+    }
+
+    bool points_into(const String&) const
+    {
+        return false;
+    }
+
+    value_type* copy_to(value_type* dst) const
+    {
+        traits_type::assign(*dst, ch);
+        return dst + 1;
+    }
+
+    value_type ch;
+};
+
+template<typename String, typename Lhs, typename Rhs>
+class StringConcat
+{
+public:
+    using value_type = typename String::value_type;
+    using string_type = String;
+
+    StringConcat(const Lhs& lhs, const Rhs& rhs)
+        : m_lhs(lhs)
+        , m_rhs(rhs)
+        , m_size(add_sat_(lhs.size(), rhs.size()))
+        , m_origin(lhs.origin() != nullptr ? lhs.origin() : rhs.origin())
+    {
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    // the leftmost string operand
+    const String* origin() const
+    {
+        return m_origin;
+    }
+
+    bool points_into(const String& s) const
+    {
+        return m_lhs.points_into(s) || m_rhs.points_into(s);
+    }
+
+    value_type* copy_to(value_type* dst) const
+    {
+        return m_rhs.copy_to(m_lhs.copy_to(dst));
+    }
+
+    String str() const
+    {
+        using alloc_traits = std::allocator_traits<typename String::allocator_type>;
+
+        String res{alloc_traits::select_on_container_copy_construction(m_origin->get_allocator())};
+        res.resize_and_overwrite(size(), [this](value_type* p, size_t n)
+        {
+            copy_to(p);
+            return n;
+        });
+
+        return res;
+    }
+
+    operator String() const
+    {
+        return str();
+    }
+
+private:
+    Lhs m_lhs; // leaves refer to their strings, nested expressions are held by value
+    Rhs m_rhs;
+    size_t m_size;
+    const String* m_origin;
+};
+
+template<typename T>
+struct concat_string_
+{
+};
+
+template<typename CharT, typename Traits, typename Allocator, typename Instrumentation, typename Growth>
+struct concat_string_<BasicString<CharT, Traits, Allocator, Instrumentation, Growth>>
+{
+    using type = BasicString<CharT, Traits, Allocator, Instrumentation, Growth>;
+};
+
+template<typename String, typename Lhs, typename Rhs>
+struct concat_string_<StringConcat<String, Lhs, Rhs>>
+{
+    using type = String;
+};
+
+// the string type of a string or of an expression, SFINAE-friendly
+template<typename T>
+using concat_string_t_ = typename concat_string_<T>::type;
+
+template<typename CharT, typename Traits, typename Allocator, typename Instrumentation, typename Growth>
+ConcatSpan_<BasicString<CharT, Traits, Allocator, Instrumentation, Growth>> as_concat_piece_(const BasicString<CharT, Traits, Allocator, Instrumentation, Growth>& str)
+{
+    return {str.data(), str.size(), std::addressof(str)};
+}
+
+template<typename String, typename Lhs, typename Rhs>
+const StringConcat<String, Lhs, Rhs>& as_concat_piece_(const StringConcat<String, Lhs, Rhs>& expr)
+{
+    return expr;
+}
+
+template<typename String>
+ConcatSpan_<String> as_concat_piece_(const typename String::value_type* buf)
+{
+    return {buf, String::traits_type::length(buf), nullptr};
+}
+
+template<typename String>
+ConcatChar_<String> as_concat_piece_(typename String::value_type ch)
+{
+    return {ch};
+}
+
+template<typename String, typename Lhs, typename Rhs>
+StringConcat<String, Lhs, Rhs> make_concat_(const Lhs& lhs, const Rhs& rhs)
+{
+    return {lhs, rhs};
+}
+
+// lhs is grown in place, unless that would move chars that rhs still has to copy
+template<typename String, typename Piece>
+String concat_append_(String&& lhs, const Piece& rhs)
+{
+    if(rhs.size() > lhs.capacity() - lhs.size() && rhs.points_into(lhs))
+    {
+        return make_concat_<String>(as_concat_piece_(lhs), rhs).str();
+    }
+
+    auto s = lhs.append_uninitialized(rhs.size());
+    rhs.copy_to(s.data());
+
+    return std::move(lhs);
+}
+
+// the chars of rhs are moved up in place, unless lhs still has to copy from them
+template<typename String, typename Piece>
+String concat_prepend_(const Piece& lhs, String&& rhs)
+{
+    using traits_type = typename String::traits_type;
+
+    if(rhs.capacity() - rhs.size() < lhs.size() || lhs.points_into(rhs))
+    {
+        return make_concat_<String>(lhs, as_concat_piece_(rhs)).str();
+    }
+
+    size_t old_size = rhs.size();
+    rhs.append_uninitialized(lhs.size());
+    traits_type::move(rhs.data() + lhs.size(), rhs.data(), old_size);
+    lhs.copy_to(rhs.data());
+
+    return std::move(rhs);
+}
+
+// lazy: string or expression, with string or expression
+
+template<typename L, typename R,
+         typename String = concat_string_t_<L>,
+         typename = std::enable_if_t<std::is_same_v<String, concat_string_t_<R>>>>
+auto operator+(const L& lhs, const R& rhs)
+{
+    return make_concat_<String>(as_concat_piece_(lhs), as_concat_piece_(rhs));
+}
+
+// lazy: string or expression, with C string or character
+
+template<typename L, typename String = concat_string_t_<L>>
+auto operator+(const L& lhs, const typename String::value_type* rhs)
+{
+    return make_concat_<String>(as_concat_piece_(lhs), as_concat_piece_<String>(rhs));
+}
+
+template<typename R, typename String = concat_string_t_<R>>
+auto operator+(const typename String::value_type* lhs, const R& rhs)
+{
+    return make_concat_<String>(as_concat_piece_<String>(lhs), as_concat_piece_(rhs));
+}
+
+template<typename L, typename String = concat_string_t_<L>>
+auto operator+(const L& lhs, typename String::value_type rhs)
+{
+    return make_concat_<String>(as_concat_piece_(lhs), as_concat_piece_<String>(rhs));
+}
+
+template<typename R, typename String = concat_string_t_<R>>
+auto operator+(typename String::value_type lhs, const R& rhs)
+{
+    return make_concat_<String>(as_concat_piece_<String>(lhs), as_concat_piece_(rhs));
+}
+
+// eager: rvalue string, appended to or prepended to in place
+
+template<typename CharT, typename Traits, typename Allocator, typename Instrumentation, typename Growth, typename R,
+         typename String = BasicString<CharT, Traits, Allocator, Instrumentation, Growth>,
+         typename = std::enable_if_t<std::is_same_v<String, concat_string_t_<R>>>>
+String operator+(BasicString<CharT, Traits, Allocator, Instrumentation, Growth>&& lhs, const R& rhs)
+{
+    return concat_append_(std::move(lhs), as_concat_piece_(rhs));
+}
+
+template<typename CharT, typename Traits, typename Allocator, typename Instrumentation, typename Growth>
+BasicString<CharT, Traits, Allocator, Instrumentation, Growth> operator+(BasicString<CharT, Traits, Allocator, Instrumentation, Growth>&& lhs, const CharT* rhs)
+{
+    return concat_append_(std::move(lhs), as_concat_piece_<BasicString<CharT, Traits, Allocator, Instrumentation, Growth>>(rhs));
+}
+
+template<typename CharT, typename Traits, typename Allocator, typename Instrumentation, typename Growth>
+BasicString<CharT, Traits, Allocator, Instrumentation, Growth> operator+(BasicString<CharT, Traits, Allocator, Instrumentation, Growth>&& lhs, CharT rhs)
+{
+    return concat_append_(std::move(lhs), as_concat_piece_<BasicString<CharT, Traits, Allocator, Instrumentation, Growth>>(rhs));
+}
+
+template<typename CharT, typename Traits, typename Allocator, typename Instrumentation, typename Growth, typename L,
+         typename String = BasicString<CharT, Traits, Allocator, Instrumentation, Growth>,
+         typename = std::enable_if_t<std::is_same_v<String, concat_string_t_<L>>>>
+String operator+(const L& lhs, BasicString<CharT, Traits, Allocator, Instrumentation, Growth>&& rhs)
+{
+    return concat_prepend_(as_concat_piece_(lhs), std::move(rhs));
+}
+
+template<typename CharT, typename Traits, typename Allocator, typename Instrumentation, typename Growth>
+BasicString<CharT, Traits, Allocator, Instrumentation, Growth> operator+(const CharT* lhs, BasicString<CharT, Traits, Allocator, Instrumentation, Growth>&& rhs)
+{
+    return concat_prepend_(as_concat_piece_<BasicString<CharT, Traits, Allocator, Instrumentation, Growth>>(lhs), std::move(rhs));
+}
+
+template<typename CharT, typename Traits, typename Allocator, typename Instrumentation, typename Growth>
+BasicString<CharT, Traits, Allocator, Instrumentation, Growth> operator+(CharT lhs, BasicString<CharT, Traits, Allocator, Instrumentation, Growth>&& rhs)
+{
+    return concat_prepend_(as_concat_piece_<BasicString<CharT, Traits, Allocator, Instrumentation, Growth>>(lhs), std::move(rhs));
+}
+
+template<typename CharT, typename Traits, typename Allocator, typename Instrumentation, typename Growth>
+BasicString<CharT, Traits, Allocator, Instrumentation, Growth> operator+(BasicString<CharT, Traits, Allocator, Instrumentation, Growth>&& lhs,
+                                                BasicString<CharT, Traits, Allocator, Instrumentation, Growth>&& rhs)
+{
+    return concat_append_(std::move(lhs), as_concat_piece_(rhs));
+}
+
+namespace std
+{
+    // of strings with the standard traits only, as their equality is bytewise
+    template<typename CharT, typename Allocator, typename Instrumentation, typename Growth>
+    struct hash<BasicString<CharT, std::char_traits<CharT>, Allocator, Instrumentation, Growth>> : BasicStringHash<CharT>
+    {
+    };
+}
+
+using String = BasicString<char>;
+using wString = BasicString<wchar_t>;
+
+#include <memory_resource>
+
+namespace pmr
+{
+    template<typename CharT, typename Traits = std::char_traits<CharT>>
+    using BasicString = ::BasicString<CharT, Traits, std::pmr::polymorphic_allocator<CharT>>;
+
+    using String = BasicString<char>;
+    using wString = BasicString<wchar_t>;
+}
@@ -0,0 +1,500 @@
+#pragma once
+
+#include "Hash.hpp"
+#include "Simd.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional> // std::hash
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <string> // std::char_traits
+#include <string_view>
+#include <type_traits>
+
+//
+// A non-owning view of a run of characters - just a pointer and a size -
+// for passing slices of a bigger buffer around without copying them.
+// Whoever hands out the view keeps the characters alive; there is no null
+// at the end, in general.
+//
+// BasicString converts to one implicitly, and so do std::basic_string_view
+// (both ways) and C strings.
+//
+template<typename CharT, typename Traits = std::char_traits<CharT>>
+class BasicStringView
+{
+public:
+    using value_type = CharT;
+    using traits_type = Traits;
+
+    static constexpr size_t npos = -1;
+
+    constexpr BasicStringView() noexcept = default;
+
+    constexpr BasicStringView(const CharT* buf, size_t sz) noexcept
+        : m_data(buf)
+        , m_size(sz)
+    {
+    }
+
+    constexpr BasicStringView(const CharT* buf)
+        : BasicStringView(buf, Traits::length(buf))
+    {
+    }
+
+    constexpr BasicStringView(std::basic_string_view<CharT, Traits> sv) noexcept
+        : BasicStringView(sv.data(), sv.size())
+    {
+    }
+
+    constexpr operator std::basic_string_view<CharT, Traits>() const noexcept
+    {
+        return {data(), size()};
+    }
+
+    //////////////////////////
+
+    constexpr size_t size() const
+    {
+        return m_size;
+    }
+
+    constexpr bool empty() const
+    {
+        return size() == 0u;
+    }
+
+    constexpr const CharT* data() const
+    {
+        return m_data;
+    }
+
+    constexpr const CharT* begin() const
+    {
+        return m_data;
+    }
+
+    constexpr const CharT* end() const
+    {
+        return m_data + m_size;
+    }
+
+    constexpr const CharT& operator[](size_t index) const
+    {
+        assert(index < size());
+
+        return m_data[index];
+    }
+
+    constexpr const CharT& at(size_t index) const
+    {
+        if(index >= size())
+            throw std::out_of_range{"bad index"};
+
+        return m_data[index];
+    }
+
+    constexpr const CharT& front() const
+    {
+        return (*this)[0];
+    }
+
+    constexpr const CharT& back() const
+    {
+        return (*this)[size() - 1];
+    }
+
+    //////////////////////////
+
+    constexpr void remove_prefix(size_t count)
+    {
+        assert(count <= size());
+
+        m_data += count;
+        m_size -= count;
+    }
+
+    constexpr void remove_suffix(size_t count)
+    {
+        assert(count <= size());
+
+        m_size -= count;
+    }
+
+    constexpr BasicStringView substr(size_t index = 0, size_t count = npos) const
+    {
+        if(index > size())
+            throw std::out_of_range{"bad index"};
+
+        return BasicStringView{data() + index, std::min(size() - index, count)};
+    }
+
+    // <0, 0 or >0, as this orders before, equal to or after rhs
+    constexpr int compare(BasicStringView rhs) const
+    {
+        int r = Traits::compare(data(), rhs.data(), std::min(size(), rhs.size()));
+        if(r != 0)
+            return r;
+
+        return size() < rhs.size() ? -1 : (size() > rhs.size() ? 1 : 0);
+    }
+
+    constexpr size_t find(const CharT* buf, size_t index, size_t sz) const
+    {
+        if(sz > size() || index > size() - sz)
+            return npos;
+
+        if(sz == 0u)
+            return index;
+
+        const CharT* beg = data() + index;
+        const CharT* end = data() + size() - sz + 1; // one past the last candidate
+        while((beg = Traits::find(beg, end - beg, *buf)) != nullptr)
+        {
+            if(Traits::compare(beg + 1, buf + 1, sz - 1) == 0)
+                return beg - data();
+
+            ++beg;
+        }
+
+        return npos;
+    }
+
+    constexpr size_t find(BasicStringView str, size_t index = 0) const
+    {
+        return find(str.data(), index, str.size());
+    }
+
+    constexpr size_t find(CharT ch, size_t index = 0) const
+    {
+        return find(&ch, index, 1u);
+    }
+
+    // first position from index of any of the chars of set
+    size_t find_first_of(BasicStringView set, size_t index = 0) const
+    {
+        if(index >= size())
+            return npos;
+
+        if constexpr(bytewise_)
+        {
+            size_t r = simd::find_first_of(reinterpret_cast<const char*>(data() + index), size() - index,
+                                           reinterpret_cast<const char*>(set.data()), set.size());
+
+            return r == simd::npos ? npos : index + r;
+        }
+
+        for(size_t i = index; i < size(); ++i)
+            if(Traits::find(set.data(), set.size(), m_data[i]) != nullptr)
+                return i;
+
+        return npos;
+    }
+
+    //////////////////////////
+
+    class split_range;
+
+    //
+    // The fields between the delimiters - any of the chars of delims - as
+    // views into this, found lazily as the range is walked:
+    //
+    //   for(StringView line : text.split("\n"))
+    //       ...
+    //
+    // Adjacent delimiters give empty fields, as does one at either end; an
+    // empty view has no fields at all.
+    //
+    split_range split(BasicStringView delims) const;
+
+    // appends the fields to out (a vector of views, say), reserving once
+    template<typename Container>
+    Container& split_into(Container& out, BasicStringView delims) const;
+
+    friend constexpr bool operator==(BasicStringView lhs, BasicStringView rhs)
+    {
+        return lhs.size() == rhs.size() && lhs.compare(rhs) == 0;
+    }
+
+    friend constexpr bool operator!=(BasicStringView lhs, BasicStringView rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    friend constexpr bool operator<(BasicStringView lhs, BasicStringView rhs)
+    {
+        return lhs.compare(rhs) < 0;
+    }
+
+    friend constexpr bool operator<=(BasicStringView lhs, BasicStringView rhs)
+    {
+        return lhs.compare(rhs) <= 0;
+    }
+
+    friend constexpr bool operator>(BasicStringView lhs, BasicStringView rhs)
+    {
+        return lhs.compare(rhs) > 0;
+    }
+
+    friend constexpr bool operator>=(BasicStringView lhs, BasicStringView rhs)
+    {
+        return lhs.compare(rhs) >= 0;
+    }
+
+private:
+    // chars that compare equal exactly when their bytes do
+    static constexpr bool bytewise_ = sizeof(CharT) == 1u
+                                   && std::is_integral_v<CharT>
+                                   && std::is_same_v<Traits, std::char_traits<CharT>>;
+
+private:
+    const CharT* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+template<typename CharT, typename Traits>
+class BasicStringView<CharT, Traits>::split_range
+{
+public:
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = BasicStringView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const BasicStringView*;
+        using reference = const BasicStringView&;
+
+        iterator() = default;
+
+        reference operator*() const
+        {
+            return m_field;
+        }
+
+        pointer operator->() const
+        {
+            return &m_field;
+        }
+
+        iterator& operator++()
+        {
+            size_t end = m_field.data() - m_range->m_text.data() + m_field.size();
+            if(end == m_range->m_text.size())
+                m_range = nullptr; // that was the last field
+            else
+                m_field = m_range->field_at_(end + 1);
+
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator res = *this;
+            ++*this;
+            return res;
+        }
+
+        friend bool operator==(const iterator& lhs, const iterator& rhs)
+        {
+            return lhs.m_range == rhs.m_range
+                && (lhs.m_range == nullptr || lhs.m_field.data() == rhs.m_field.data());
+        }
+
+        friend bool operator!=(const iterator& lhs, const iterator& rhs)
+        {
+            return !(lhs == rhs);
+        }
+
+    private:
+        friend class split_range;
+
+        iterator(const split_range* range, BasicStringView field)
+            : m_range(range)
+            , m_field(field)
+        {
+        }
+
+        const split_range* m_range = nullptr; // null at the end
+        BasicStringView m_field;
+    };
+
+    split_range(BasicStringView text, BasicStringView delims)
+        : m_text(text)
+        , m_delims(delims)
+    {
+    }
+
+    iterator begin() const
+    {
+        return m_text.empty() ? end() : iterator{this, field_at_(0u)};
+    }
+
+    iterator end() const
+    {
+        return iterator{};
+    }
+
+    // the number of fields, in one scan
+    size_t count() const
+    {
+        if(m_text.empty())
+            return 0u;
+
+        size_t res = 1u;
+        for(size_t i = m_text.find_first_of(m_delims); i != npos; i = m_text.find_first_of(m_delims, i + 1))
+            ++res;
+
+        return res;
+    }
+
+private:
+    // the field that starts at index
+    BasicStringView field_at_(size_t index) const
+    {
+        size_t end = m_text.find_first_of(m_delims, index);
+        if(end == npos)
+            end = m_text.size();
+
+        return BasicStringView{m_text.data() + index, end - index};
+    }
+
+    BasicStringView m_text;
+    BasicStringView m_delims;
+};
+
+template<typename CharT, typename Traits>
+typename BasicStringView<CharT, Traits>::split_range BasicStringView<CharT, Traits>::split(BasicStringView delims) const
+{
+    return split_range{*this, delims};
+}
+
+template<typename CharT, typename Traits>
+template<typename Container>
+Container& BasicStringView<CharT, Traits>::split_into(Container& out, BasicStringView delims) const
+{
+    split_range fields = split(delims);
+
+    out.reserve(out.size() + fields.count());
+    for(BasicStringView field : fields)
+        out.emplace_back(field);
+
+    return out;
+}
+
+//
+// Formatted output, padded with the fill of the stream to its width, as for
+// std::string; but the chars go to the stream buffer in a single sputn,
+// and the padding in blocks.
+//
+// What the buffer throws sets badbit, and is rethrown if the stream asks
+// for exceptions on badbit, as the standard inserters do.
+//
+template<typename CharT, typename Traits>
+std::basic_ostream<CharT>& operator<<(std::basic_ostream<CharT>& os, BasicStringView<CharT, Traits> rhs)
+{
+    typename std::basic_ostream<CharT>::sentry ok{os};
+    if(!ok)
+        return os;
+
+    std::basic_streambuf<CharT>* buf = os.rdbuf();
+
+    size_t width = os.width() > 0 ? static_cast<size_t>(os.width()) : 0u;
+    size_t pad = width > rhs.size() ? width - rhs.size() : 0u;
+    bool left = (os.flags() & std::ios_base::adjustfield) == std::ios_base::left;
+
+    auto pad_out = [buf, fill = os.fill()](size_t count)
+    {
+        CharT block[64];
+        std::fill_n(block, 64, fill);
+
+        for(size_t n; count > 0u; count -= n)
+        {
+            n = std::min<size_t>(count, 64u);
+            if(buf->sputn(block, static_cast<std::streamsize>(n)) != static_cast<std::streamsize>(n))
+                return false;
+        }
+
+        return true;
+    };
+
+    bool done = false;
+    try
+    {
+        done = (left || pad_out(pad))
+            && buf->sputn(rhs.data(), static_cast<std::streamsize>(rhs.size())) == static_cast<std::streamsize>(rhs.size())
+            && (!left || pad_out(pad));
+    }
+    catch(...)
+    {
+        if(os.exceptions() & std::ios_base::badbit)
+        {
+            os.width(0);
+
+            try
+            {
+                os.setstate(std::ios_base::badbit); // throws ios_base::failure, not the one to pass on
+            }
+            catch(const std::ios_base::failure&)
+            {
+            }
+
+            throw;
+        }
+    }
+
+    os.width(0);
+    if(!done)
+        os.setstate(std::ios_base::badbit);
+
+    return os;
+}
+
+//
+// Hash and equality of anything that converts to a view: BasicStrings (of
+// any allocator), views and C strings of the same contents hash the same.
+// Both are transparent, for the heterogeneous lookup of C++20 unordered
+// containers - a table of strings can be searched with a view, and no
+// string is made for it.
+//
+template<typename CharT>
+struct BasicStringHash
+{
+    using is_transparent = void;
+
+    size_t operator()(BasicStringView<CharT> str) const
+    {
+        return static_cast<size_t>(hashing::hash_bytes(str.data(), str.size() * sizeof(CharT)));
+    }
+};
+
+template<typename CharT>
+struct BasicStringEqual
+{
+    using is_transparent = void;
+
+    bool operator()(BasicStringView<CharT> lhs, BasicStringView<CharT> rhs) const
+    {
+        return lhs == rhs;
+    }
+};
+
+namespace std
+{
+    // of views with the standard traits only, as their equality is bytewise
+    template<typename CharT>
+    struct hash<BasicStringView<CharT, std::char_traits<CharT>>> : BasicStringHash<CharT>
+    {
+    };
+}
+
+using StringView = BasicStringView<char>;
+using wStringView = BasicStringView<wchar_t>;
+
+using StringHash = BasicStringHash<char>;
+using wStringHash = BasicStringHash<wchar_t>;
+using StringEqual = BasicStringEqual<char>;
+using wStringEqual = BasicStringEqual<wchar_t>;
@@ -0,0 +1,268 @@
+#pragma once
+
+#include "Simd.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+//
+// Hashing of byte sequences, for hash tables of strings; not for
+// cryptographic use, and the values may change between versions.
+//
+// Inputs of up to 256 bytes are hashed with wyhash. Longer ones are first
+// folded into eight 64 bit lanes, 64 bytes at a time, by an xxh3-style
+// accumulator; its x86 version runs the lanes as two AVX2 vectors, and
+// gives the same values as the portable one.
+//
+namespace hashing
+{
+    inline constexpr uint64_t secret_[4] = {
+        0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+    };
+
+    // the keys of the accumulator: a stripe of 64 bytes takes 8 of them,
+    // from an offset that moves by one with each stripe of a block
+    inline constexpr size_t stripe_bytes_ = 64u;
+    inline constexpr size_t block_stripes_ = 16u;
+
+    constexpr std::array<uint64_t, block_stripes_ + 8u> make_keys_()
+    {
+        std::array<uint64_t, block_stripes_ + 8u> res = {};
+
+        uint64_t x = 0u; // splitmix64
+        for(uint64_t& k : res)
+        {
+            x += 0x9e3779b97f4a7c15ull;
+            uint64_t z = x;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            k = z ^ (z >> 31);
+        }
+
+        return res;
+    }
+
+    inline constexpr std::array<uint64_t, block_stripes_ + 8u> keys_ = make_keys_();
+
+    inline uint64_t read8_(const unsigned char* p)
+    {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        return v;
+    }
+
+    inline uint64_t read4_(const unsigned char* p)
+    {
+        uint32_t v;
+        std::memcpy(&v, p, 4);
+        return v;
+    }
+
+    // the low and the high half of the 128 bit product
+    inline void mum_(uint64_t& a, uint64_t& b)
+    {
+#ifdef __SIZEOF_INT128__
+        __uint128_t r = static_cast<__uint128_t>(a) * b;
+        a = static_cast<uint64_t>(r);
+        b = static_cast<uint64_t>(r >> 64);
+#else
+        uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+        uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+        uint64_t t = rl + (rm0 << 32);
+        uint64_t c = t < rl;
+        uint64_t lo = t + (rm1 << 32);
+        c += lo < t;
+        a = lo;
+        b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+    }
+
+    inline uint64_t mix_(uint64_t a, uint64_t b)
+    {
+        mum_(a, b);
+        return a ^ b;
+    }
+
+    // wyhash (final version 4)
+    inline uint64_t hash_short_(const unsigned char* p, size_t n, uint64_t seed)
+    {
+        seed ^= mix_(seed ^ secret_[0], secret_[1]);
+
+        uint64_t a = 0u;
+        uint64_t b = 0u;
+        if(n <= 16u)
+        {
+            if(n >= 4u)
+            {
+                a = (read4_(p) << 32) | read4_(p + ((n >> 3) << 2));
+                b = (read4_(p + n - 4) << 32) | read4_(p + n - 4 - ((n >> 3) << 2));
+            }
+            else if(n > 0u)
+            {
+                a = (uint64_t(p[0]) << 16) | (uint64_t(p[n >> 1]) << 8) | p[n - 1];
+            }
+        }
+        else
+        {
+            size_t i = n;
+            if(i > 48u)
+            {
+                uint64_t see1 = seed;
+                uint64_t see2 = seed;
+                do
+                {
+                    seed = mix_(read8_(p) ^ secret_[1], read8_(p + 8) ^ seed);
+                    see1 = mix_(read8_(p + 16) ^ secret_[2], read8_(p + 24) ^ see1);
+                    see2 = mix_(read8_(p + 32) ^ secret_[3], read8_(p + 40) ^ see2);
+                    p += 48;
+                    i -= 48;
+                }
+                while(i > 48u);
+
+                seed ^= see1 ^ see2;
+            }
+
+            while(i > 16u)
+            {
+                seed = mix_(read8_(p) ^ secret_[1], read8_(p + 8) ^ seed);
+                i -= 16;
+                p += 16;
+            }
+
+            a = read8_(p + i - 16);
+            b = read8_(p + i - 8);
+        }
+
+        a ^= secret_[1];
+        b ^= seed;
+        mum_(a, b);
+        return mix_(a ^ secret_[0] ^ n, b ^ secret_[1]);
+    }
+
+    //
+    // The accumulator, over stripes of 64 bytes: lane i gets the product of
+    // the two halves of (data ^ key) for i, and the data for its neighbour
+    // i ^ 1. After every block of stripes the lanes are scrambled.
+    //
+    inline void accumulate_scalar(uint64_t* acc, const unsigned char* p, size_t stripes, const uint64_t* keys)
+    {
+        for(size_t s = 0u; s < stripes; ++s)
+        {
+            for(size_t i = 0u; i < 8u; ++i)
+            {
+                uint64_t v = read8_(p + s * stripe_bytes_ + i * 8u);
+                uint64_t k = v ^ keys[s + i];
+                acc[i ^ 1u] += v;
+                acc[i] += (k & 0xffffffffu) * (k >> 32);
+            }
+        }
+    }
+
+    inline void scramble_scalar(uint64_t* acc, const uint64_t* keys)
+    {
+        for(size_t i = 0u; i < 8u; ++i)
+        {
+            uint64_t a = acc[i];
+            a ^= a >> 47;
+            a ^= keys[i];
+            acc[i] = a * 0x9e3779b1u;
+        }
+    }
+
+#if BASIC_STRING_SIMD_X86
+    __attribute__((target("avx2")))
+    inline void accumulate_avx2(uint64_t* acc, const unsigned char* p, size_t stripes, const uint64_t* keys)
+    {
+        __m256i acc0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc));
+        __m256i acc1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + 4));
+
+        for(size_t s = 0u; s < stripes; ++s)
+        {
+            const unsigned char* stripe = p + s * stripe_bytes_;
+            __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(stripe));
+            __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(stripe + 32));
+            __m256i k0 = _mm256_xor_si256(v0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + s)));
+            __m256i k1 = _mm256_xor_si256(v1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + s + 4)));
+
+            // neighbouring lanes i and i ^ 1 share a 128 bit half, where the shuffle swaps them
+            acc0 = _mm256_add_epi64(acc0, _mm256_shuffle_epi32(v0, _MM_SHUFFLE(1, 0, 3, 2)));
+            acc1 = _mm256_add_epi64(acc1, _mm256_shuffle_epi32(v1, _MM_SHUFFLE(1, 0, 3, 2)));
+            acc0 = _mm256_add_epi64(acc0, _mm256_mul_epu32(k0, _mm256_srli_epi64(k0, 32)));
+            acc1 = _mm256_add_epi64(acc1, _mm256_mul_epu32(k1, _mm256_srli_epi64(k1, 32)));
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc), acc0);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + 4), acc1);
+    }
+
+    __attribute__((target("avx2")))
+    inline void scramble_avx2(uint64_t* acc, const uint64_t* keys)
+    {
+        const __m256i prime = _mm256_set1_epi64x(0x9e3779b1u);
+
+        for(size_t i = 0u; i < 8u; i += 4u)
+        {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+            a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+            a = _mm256_xor_si256(a, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)));
+
+            // a 64 by 32 bit product, from two 32 by 32 bit ones
+            __m256i lo = _mm256_mul_epu32(a, prime);
+            __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+            a = _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + i), a);
+        }
+    }
+#endif
+
+    // the hash of n > 256 bytes
+    inline uint64_t hash_long_(const unsigned char* p, size_t n, uint64_t seed)
+    {
+        auto accumulate = accumulate_scalar;
+        auto scramble = scramble_scalar;
+#if BASIC_STRING_SIMD_X86
+        if(simd::has_avx2())
+        {
+            accumulate = accumulate_avx2;
+            scramble = scramble_avx2;
+        }
+#endif
+
+        uint64_t acc[8] = {
+            0xc2b2ae3du, 0x9e3779b185ebca87ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull,
+            0x85ebca77c2b2ae63ull, 0x85ebca77u, 0x27d4eb2f165667c5ull, 0x9e3779b1u
+        };
+
+        // whole blocks, then whole stripes, leaving at least one byte
+        const size_t block_bytes = block_stripes_ * stripe_bytes_;
+        size_t blocks = (n - 1u) / block_bytes;
+        for(size_t b = 0u; b < blocks; ++b)
+        {
+            accumulate(acc, p + b * block_bytes, block_stripes_, keys_.data());
+            scramble(acc, keys_.data() + block_stripes_);
+        }
+
+        size_t stripes = (n - 1u - blocks * block_bytes) / stripe_bytes_;
+        accumulate(acc, p + blocks * block_bytes, stripes, keys_.data());
+
+        // and the last 64 bytes, overlapping what came before
+        accumulate(acc, p + n - stripe_bytes_, 1u, keys_.data() + block_stripes_ - 1u);
+
+        uint64_t h = n * 0x9e3779b185ebca87ull ^ seed;
+        for(size_t i = 0u; i < 8u; i += 2u)
+            h += mix_(acc[i] ^ keys_[i], acc[i + 1] ^ keys_[i + 1] ^ seed);
+
+        h ^= h >> 37;
+        h *= 0x165667919e3779f9ull;
+        return h ^ (h >> 32);
+    }
+
+    inline uint64_t hash_bytes(const void* data, size_t n, uint64_t seed = 0u)
+    {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        return n <= 256u ? hash_short_(p, n, seed) : hash_long_(p, n, seed);
+    }
+}
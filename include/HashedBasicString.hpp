@@ -0,0 +1,250 @@
+#pragma once
+
+#include "BasicString.hpp"
+
+#include <atomic>
+
+//
+// A BasicString that remembers its hash: it is computed on first use, and
+// forgotten on any change to the contents. For keys that get hashed over
+// and over - looked up in many tables, or moved between them, say.
+//
+// The contents can be read freely, but only changed through the mutators
+// below, or modify(), all of which forget the hash. Reading the hash from
+// several threads at once is fine; they all compute the same value.
+//
+template<typename CharT, typename Allocator = std::allocator<CharT>>
+class HashedBasicString
+{
+public:
+    using string_type = BasicString<CharT, std::char_traits<CharT>, Allocator>;
+    using view_type = typename string_type::view_type;
+    using value_type = CharT;
+
+    static constexpr size_t npos = string_type::npos;
+
+    HashedBasicString() = default;
+
+    HashedBasicString(string_type str)
+        : m_str(std::move(str))
+    {
+    }
+
+    HashedBasicString(const CharT* buf, size_t sz)
+        : m_str(buf, sz)
+    {
+    }
+
+    HashedBasicString(const CharT* buf)
+        : m_str(buf)
+    {
+    }
+
+    HashedBasicString(const HashedBasicString& rhs)
+        : m_str(rhs.m_str)
+        , m_hash(rhs.m_hash.load(std::memory_order_relaxed))
+    {
+    }
+
+    HashedBasicString(HashedBasicString&& rhs) noexcept
+        : m_str(std::move(rhs.m_str))
+        , m_hash(rhs.m_hash.exchange(unknown_, std::memory_order_relaxed))
+    {
+    }
+
+    HashedBasicString& operator=(HashedBasicString rhs) noexcept
+    {
+        swap(*this, rhs);
+        return *this;
+    }
+
+    friend void swap(HashedBasicString& lhs, HashedBasicString& rhs) noexcept
+    {
+        using std::swap;
+
+        swap(lhs.m_str, rhs.m_str);
+
+        size_t h = lhs.m_hash.load(std::memory_order_relaxed);
+        lhs.m_hash.store(rhs.m_hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        rhs.m_hash.store(h, std::memory_order_relaxed);
+    }
+
+    //////////////////////////
+
+    size_t hash() const
+    {
+        size_t h = m_hash.load(std::memory_order_relaxed);
+        if(h == unknown_)
+        {
+            h = BasicStringHash<CharT>{}(m_str);
+            if(h == unknown_)
+                h = ~unknown_;
+
+            m_hash.store(h, std::memory_order_relaxed);
+        }
+
+        return h;
+    }
+
+    const string_type& str() const
+    {
+        return m_str;
+    }
+
+    // takes the string out, leaving this empty
+    string_type release()
+    {
+        forget_hash_();
+        return std::exchange(m_str, string_type{m_str.get_allocator()});
+    }
+
+    operator view_type() const noexcept
+    {
+        return m_str;
+    }
+
+    size_t size() const
+    {
+        return m_str.size();
+    }
+
+    bool empty() const
+    {
+        return m_str.empty();
+    }
+
+    const CharT* data() const
+    {
+        return m_str.data();
+    }
+
+    const CharT* c_str() const
+    {
+        return m_str.c_str();
+    }
+
+    const CharT& operator[](size_t index) const
+    {
+        return m_str[index];
+    }
+
+    //////////////////////////
+
+    template<typename... Args>
+    HashedBasicString& assign(Args&&... args)
+    {
+        forget_hash_();
+        m_str.assign(std::forward<Args>(args)...);
+        return *this;
+    }
+
+    template<typename... Args>
+    HashedBasicString& append(Args&&... args)
+    {
+        forget_hash_();
+        m_str.append(std::forward<Args>(args)...);
+        return *this;
+    }
+
+    template<typename... Args>
+    HashedBasicString& insert(Args&&... args)
+    {
+        forget_hash_();
+        m_str.insert(std::forward<Args>(args)...);
+        return *this;
+    }
+
+    template<typename... Args>
+    HashedBasicString& replace(Args&&... args)
+    {
+        forget_hash_();
+        m_str.replace(std::forward<Args>(args)...);
+        return *this;
+    }
+
+    template<typename... Args>
+    size_t replace_all(Args&&... args)
+    {
+        forget_hash_();
+        return m_str.replace_all(std::forward<Args>(args)...);
+    }
+
+    HashedBasicString& erase(size_t index, size_t count = npos)
+    {
+        forget_hash_();
+        m_str.erase(index, count);
+        return *this;
+    }
+
+    HashedBasicString& push_back(CharT ch)
+    {
+        forget_hash_();
+        m_str.push_back(ch);
+        return *this;
+    }
+
+    void resize(size_t count, CharT ch = CharT())
+    {
+        forget_hash_();
+        m_str.resize(count, ch);
+    }
+
+    void clear()
+    {
+        forget_hash_();
+        m_str.clear();
+    }
+
+    // calls f(string_type&) for any other change, and returns what it does
+    template<typename F>
+    decltype(auto) modify(F&& f)
+    {
+        forget_hash_();
+        return std::forward<F>(f)(m_str);
+    }
+
+    //////////////////////////
+
+    // unequal hashes, when both are known, settle it without comparing the contents
+    friend bool operator==(const HashedBasicString& lhs, const HashedBasicString& rhs)
+    {
+        size_t lh = lhs.m_hash.load(std::memory_order_relaxed);
+        size_t rh = rhs.m_hash.load(std::memory_order_relaxed);
+        if(lh != unknown_ && rh != unknown_ && lh != rh)
+            return false;
+
+        return view_type(lhs) == view_type(rhs);
+    }
+
+    friend bool operator!=(const HashedBasicString& lhs, const HashedBasicString& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    static constexpr size_t unknown_ = 0u;
+
+    void forget_hash_()
+    {
+        m_hash.store(unknown_, std::memory_order_relaxed);
+    }
+
+private:
+    string_type m_str;
+    mutable std::atomic<size_t> m_hash{unknown_};
+};
+
+namespace std
+{
+    template<typename CharT, typename Allocator>
+    struct hash<HashedBasicString<CharT, Allocator>>
+    {
+        size_t operator()(const HashedBasicString<CharT, Allocator>& str) const
+        {
+            return str.hash();
+        }
+    };
+}
+
+using HashedString = HashedBasicString<char>;
+using wHashedString = HashedBasicString<wchar_t>;
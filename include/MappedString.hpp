@@ -0,0 +1,385 @@
+#pragma once
+
+#include "BasicString.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//
+// The contents of a file, mapped into memory read-only, with the const
+// query API of BasicString: for big files that are only searched and
+// sliced, so that the page cache holds the only copy of the text, and
+// pages are read in as they are touched.
+//
+// The size is that of the file, in whole chars, at the time it is opened;
+// the file must not be truncated while it is mapped. There is no null at
+// the end, so there is no c_str().
+//
+// advise() tells the kernel how the text is going to be read, so it can
+// read ahead (sequential) or not (random), or fetch or drop pages early.
+// POSIX only.
+//
+template<typename CharT, typename Traits = std::char_traits<CharT>>
+class BasicMappedString
+{
+    using string_type_ = BasicString<CharT, Traits>;
+
+    static_assert( std::is_trivial_v<CharT> );
+
+    // what the comparison operators take, besides BasicMappedString: views,
+    // C strings...; a BasicString brings its own
+    template<typename T>
+    using if_comparable_ = std::enable_if_t<!std::is_same_v<T, BasicMappedString>
+                                         && !std::is_same_v<T, string_type_>
+                                         && std::is_convertible_v<const T&, BasicStringView<CharT, Traits>>, int>;
+
+public:
+    using value_type = CharT;
+    using traits_type = Traits;
+    using view_type = BasicStringView<CharT, Traits>;
+
+    static constexpr size_t npos = -1;
+
+    enum class access
+    {
+        normal,
+        sequential, // read ahead aggressively, and drop what was read soon
+        random,     // no read ahead
+        will_need,  // start reading in now
+        dont_need   // done with it for now; the pages may be dropped
+    };
+
+    BasicMappedString() = default;
+
+    explicit BasicMappedString(const char* path, access hint = access::normal)
+    {
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+            throw std::system_error{errno, std::generic_category(), "open"};
+
+        struct stat st;
+        if(::fstat(fd, &st) != 0)
+        {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error{err, std::generic_category(), "fstat"};
+        }
+
+        m_bytes = static_cast<size_t>(st.st_size);
+        if(m_bytes > 0u)
+        {
+            void* p = ::mmap(nullptr, m_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(p == MAP_FAILED)
+            {
+                int err = errno;
+                ::close(fd);
+                throw std::system_error{err, std::generic_category(), "mmap"};
+            }
+
+            m_data = static_cast<const CharT*>(p);
+        }
+
+        ::close(fd); // the mapping keeps the file open
+        m_size = m_bytes / sizeof(CharT);
+
+        if(hint != access::normal)
+            advise(hint);
+    }
+
+    BasicMappedString(BasicMappedString&& rhs) noexcept
+        : m_data(std::exchange(rhs.m_data, nullptr))
+        , m_size(std::exchange(rhs.m_size, 0u))
+        , m_bytes(std::exchange(rhs.m_bytes, 0u))
+    {
+    }
+
+    BasicMappedString& operator=(BasicMappedString rhs) noexcept
+    {
+        swap(*this, rhs);
+        return *this;
+    }
+
+    friend void swap(BasicMappedString& lhs, BasicMappedString& rhs) noexcept
+    {
+        using std::swap;
+
+        swap(lhs.m_data, rhs.m_data);
+        swap(lhs.m_size, rhs.m_size);
+        swap(lhs.m_bytes, rhs.m_bytes);
+    }
+
+    ~BasicMappedString()
+    {
+        if(m_data != nullptr)
+            ::munmap(const_cast<CharT*>(m_data), m_bytes);
+    }
+
+    //////////////////////////
+
+    // of the chars [index, index + count), widened to whole pages; only a hint,
+    // so failures are ignored
+    void advise(access hint, size_t index = 0, size_t count = npos) const
+    {
+        if(index >= size())
+            return;
+
+        count = std::min(size() - index, count);
+
+        static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+
+        uintptr_t beg = reinterpret_cast<uintptr_t>(m_data + index) / page * page;
+        uintptr_t end = reinterpret_cast<uintptr_t>(m_data + index + count);
+
+        int advice = MADV_NORMAL;
+        switch(hint)
+        {
+        case access::normal:     advice = MADV_NORMAL; break;
+        case access::sequential: advice = MADV_SEQUENTIAL; break;
+        case access::random:     advice = MADV_RANDOM; break;
+        case access::will_need:  advice = MADV_WILLNEED; break;
+        case access::dont_need:  advice = MADV_DONTNEED; break;
+        }
+
+        ::madvise(reinterpret_cast<void*>(beg), end - beg, advice);
+    }
+
+    //////////////////////////
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return size() == 0u;
+    }
+
+    // not null terminated
+    const CharT* data() const
+    {
+        static const CharT null = CharT();
+        return m_data != nullptr ? m_data : std::addressof(null);
+    }
+
+    operator view_type() const noexcept
+    {
+        return view_type{data(), size()};
+    }
+
+    const CharT& operator[](size_t index) const
+    {
+        assert(index < size());
+
+        return data()[index];
+    }
+
+    const CharT& at(size_t index) const
+    {
+        if(index >= size())
+            throw std::out_of_range{"bad index"};
+
+        return data()[index];
+    }
+
+    const CharT& front() const
+    {
+        return (*this)[0];
+    }
+
+    const CharT& back() const
+    {
+        return (*this)[size() - 1];
+    }
+
+    //////////////////////////
+
+    // a copy, into memory of its own
+    string_type_ substr(size_t index = 0, size_t count = npos) const
+    {
+        if(index >= size())
+            throw std::out_of_range{"bad index"};
+
+        return string_type_{data() + index, std::min(size() - index, count)};
+    }
+
+    // as substr(), but without a copy; the view is good while this is mapped
+    view_type substr_view(size_t index = 0, size_t count = npos) const
+    {
+        if(index >= size())
+            throw std::out_of_range{"bad index"};
+
+        return view_type{data() + index, std::min(size() - index, count)};
+    }
+
+    // the fields between delimiters, as views; see BasicStringView::split()
+    typename view_type::split_range split(view_type delims) const
+    {
+        return view_type(*this).split(delims);
+    }
+
+    template<typename Container>
+    Container& split_into(Container& out, view_type delims) const
+    {
+        return view_type(*this).split_into(out, delims);
+    }
+
+    size_t find(const CharT* buf, size_t index, size_t sz) const
+    {
+        return string_type_::find_(data(), size(), buf, index, sz);
+    }
+
+    size_t find(const CharT* buf, size_t index = 0) const
+    {
+        return find(buf, index, Traits::length(buf));
+    }
+
+    size_t find(view_type str, size_t index = 0) const
+    {
+        return find(str.data(), index, str.size());
+    }
+
+    size_t find(const typename string_type_::searcher& s, size_t index = 0) const
+    {
+        if(index > size())
+            return npos;
+
+        size_t r = s.search(data() + index, size() - index);
+        return r == npos ? npos : index + r;
+    }
+
+    int compare(view_type rhs) const
+    {
+        return string_type_::compare_(*this, rhs);
+    }
+
+    //
+    // Comparisons with mapped strings, views and C strings, as BasicString
+    // has them; those with a BasicString are its own.
+    //
+    friend bool operator==(const BasicMappedString& lhs, const BasicMappedString& rhs)
+    {
+        return equal_(lhs, rhs);
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator==(const BasicMappedString& lhs, const T& rhs)
+    {
+        return equal_(lhs, rhs);
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator==(const T& lhs, const BasicMappedString& rhs)
+    {
+        return equal_(lhs, rhs);
+    }
+
+    friend bool operator!=(const BasicMappedString& lhs, const BasicMappedString& rhs)
+    {
+        return !equal_(lhs, rhs);
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator!=(const BasicMappedString& lhs, const T& rhs)
+    {
+        return !equal_(lhs, rhs);
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator!=(const T& lhs, const BasicMappedString& rhs)
+    {
+        return !equal_(lhs, rhs);
+    }
+
+    friend bool operator<(const BasicMappedString& lhs, const BasicMappedString& rhs)
+    {
+        return compare_(lhs, rhs) < 0;
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator<(const BasicMappedString& lhs, const T& rhs)
+    {
+        return compare_(lhs, rhs) < 0;
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator<(const T& lhs, const BasicMappedString& rhs)
+    {
+        return compare_(lhs, rhs) < 0;
+    }
+
+    friend bool operator<=(const BasicMappedString& lhs, const BasicMappedString& rhs)
+    {
+        return compare_(lhs, rhs) <= 0;
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator<=(const BasicMappedString& lhs, const T& rhs)
+    {
+        return compare_(lhs, rhs) <= 0;
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator<=(const T& lhs, const BasicMappedString& rhs)
+    {
+        return compare_(lhs, rhs) <= 0;
+    }
+
+    friend bool operator>(const BasicMappedString& lhs, const BasicMappedString& rhs)
+    {
+        return compare_(lhs, rhs) > 0;
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator>(const BasicMappedString& lhs, const T& rhs)
+    {
+        return compare_(lhs, rhs) > 0;
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator>(const T& lhs, const BasicMappedString& rhs)
+    {
+        return compare_(lhs, rhs) > 0;
+    }
+
+    friend bool operator>=(const BasicMappedString& lhs, const BasicMappedString& rhs)
+    {
+        return compare_(lhs, rhs) >= 0;
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator>=(const BasicMappedString& lhs, const T& rhs)
+    {
+        return compare_(lhs, rhs) >= 0;
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator>=(const T& lhs, const BasicMappedString& rhs)
+    {
+        return compare_(lhs, rhs) >= 0;
+    }
+
+private:
+    static bool equal_(view_type lhs, view_type rhs)
+    {
+        return string_type_::equal_(lhs, rhs);
+    }
+
+    static int compare_(view_type lhs, view_type rhs)
+    {
+        return string_type_::compare_(lhs, rhs);
+    }
+
+    const CharT* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_bytes = 0; // of the mapping
+};
+
+using MappedString = BasicMappedString<char>;
+using wMappedString = BasicMappedString<wchar_t>;
@@ -0,0 +1,203 @@
+#pragma once
+
+#include "BasicString.hpp"
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+//
+// Searches of very large strings on all cores: par_find(), par_count() and
+// par_find_all() take any haystack with a value_type and traits_type that
+// converts to a view - a BasicString, a view, a MappedString...
+//
+// The candidate positions are cut into chunks, searched on a ThreadPool,
+// each reading needle size - 1 chars past its end so that matches across
+// chunk borders are found exactly once. The results do not depend on the
+// number of threads: par_find() gives the leftmost match, and the others
+// count or list every match, overlapping ones included, in order.
+//
+// Haystacks smaller than serial_below are searched on the calling thread,
+// as one chunk, with the same searcher; the pool is not even made then.
+//
+// An empty needle throws std::invalid_argument, from all three.
+//
+struct ParallelOptions
+{
+    ThreadPool* pool = nullptr;             // the shared one if null
+    size_t serial_below = size_t(1) << 20;  // chars
+    size_t min_chunk = size_t(1) << 16;     // candidate positions per task, at least
+};
+
+namespace parallel_search
+{
+    template<typename Hay>
+    using view_t = BasicStringView<typename Hay::value_type, typename Hay::traits_type>;
+
+    template<typename View>
+    using searcher_t = typename BasicString<typename View::value_type, typename View::traits_type>::searcher;
+
+    // how the candidate positions of a needle are cut into chunks
+    struct plan_t
+    {
+        size_t positions;
+        size_t chunk;
+        size_t chunks;
+        ThreadPool* pool; // null to search on the calling thread
+    };
+
+    inline plan_t plan_(size_t n, size_t m, const ParallelOptions& opts)
+    {
+        size_t positions = n - m + 1u;
+        plan_t serial{positions, positions, 1u, nullptr};
+
+        if(n < opts.serial_below)
+            return serial;
+
+        ThreadPool& pool = opts.pool != nullptr ? *opts.pool : ThreadPool::shared();
+        if(pool.size() == 1u)
+            return serial;
+
+        // a few chunks per thread, for the balance; none much smaller than the needle
+        size_t chunk = std::max({positions / (pool.size() * 4u), opts.min_chunk, m * 4u});
+        return plan_t{positions, chunk, (positions + chunk - 1u) / chunk, &pool};
+    }
+
+    // calls f(chunk, first, last) for each chunk [first, last) of the plan
+    template<typename F>
+    void run_(const plan_t& plan, F&& f)
+    {
+        auto one = [&](size_t i)
+        {
+            f(i, i * plan.chunk, std::min(plan.positions, (i + 1u) * plan.chunk));
+        };
+
+        if(plan.pool == nullptr)
+            one(0u);
+        else
+            plan.pool->for_each_index(plan.chunks, one);
+    }
+
+    // calls f(position) for each match starting in [first, last), while it returns true
+    template<typename View, typename F>
+    void scan_(View hay, const searcher_t<View>& s, size_t m, size_t first, size_t last, F&& f)
+    {
+        const auto* p = hay.data();
+        size_t end = last + m - 1u; // of the chars the matches starting before last cover
+
+        for(size_t i = first; i < last; ++i)
+        {
+            size_t r = s.search(p + i, end - i);
+            if(r == View::npos || (i += r) >= last || !f(i))
+                return;
+        }
+    }
+
+    template<typename View>
+    void check_needle_(View needle)
+    {
+        if(needle.empty())
+            throw std::invalid_argument{"empty needle"};
+    }
+}
+
+// the position of the leftmost match, as find() would give; npos if none
+template<typename Hay>
+size_t par_find(const Hay& hay, parallel_search::view_t<Hay> needle, const ParallelOptions& opts = {})
+{
+    using view_type = parallel_search::view_t<Hay>;
+
+    view_type text = hay;
+    parallel_search::check_needle_(needle);
+    if(needle.size() > text.size())
+        return view_type::npos;
+
+    parallel_search::searcher_t<view_type> s{needle.data(), needle.size()};
+
+    // chunks past the best match so far are skipped, and none before it are
+    std::atomic<size_t> best{view_type::npos};
+    parallel_search::run_(parallel_search::plan_(text.size(), needle.size(), opts), [&](size_t, size_t first, size_t last)
+    {
+        if(first >= best.load(std::memory_order_relaxed))
+            return;
+
+        parallel_search::scan_(text, s, needle.size(), first, last, [&best](size_t pos)
+        {
+            size_t cur = best.load(std::memory_order_relaxed);
+            while(pos < cur && !best.compare_exchange_weak(cur, pos, std::memory_order_relaxed))
+                ;
+
+            return false;
+        });
+    });
+
+    return best.load(std::memory_order_relaxed);
+}
+
+// the number of matches, overlapping ones included
+template<typename Hay>
+size_t par_count(const Hay& hay, parallel_search::view_t<Hay> needle, const ParallelOptions& opts = {})
+{
+    using view_type = parallel_search::view_t<Hay>;
+
+    view_type text = hay;
+    parallel_search::check_needle_(needle);
+    if(needle.size() > text.size())
+        return 0u;
+
+    parallel_search::searcher_t<view_type> s{needle.data(), needle.size()};
+
+    std::atomic<size_t> total{0u};
+    parallel_search::run_(parallel_search::plan_(text.size(), needle.size(), opts), [&](size_t, size_t first, size_t last)
+    {
+        size_t count = 0u;
+        parallel_search::scan_(text, s, needle.size(), first, last, [&count](size_t)
+        {
+            ++count;
+            return true;
+        });
+
+        total.fetch_add(count, std::memory_order_relaxed);
+    });
+
+    return total.load(std::memory_order_relaxed);
+}
+
+// the positions of all the matches, overlapping ones included, in order
+template<typename Hay>
+std::vector<size_t> par_find_all(const Hay& hay, parallel_search::view_t<Hay> needle, const ParallelOptions& opts = {})
+{
+    using view_type = parallel_search::view_t<Hay>;
+
+    view_type text = hay;
+    parallel_search::check_needle_(needle);
+    if(needle.size() > text.size())
+        return {};
+
+    parallel_search::searcher_t<view_type> s{needle.data(), needle.size()};
+
+    parallel_search::plan_t plan = parallel_search::plan_(text.size(), needle.size(), opts);
+
+    // one list per chunk, joined in order at the end
+    std::vector<std::vector<size_t>> found(plan.chunks);
+    parallel_search::run_(plan, [&](size_t chunk, size_t first, size_t last)
+    {
+        parallel_search::scan_(text, s, needle.size(), first, last, [&found, chunk](size_t pos)
+        {
+            found[chunk].push_back(pos);
+            return true;
+        });
+    });
+
+    size_t total = 0u;
+    for(const std::vector<size_t>& f : found)
+        total += f.size();
+
+    std::vector<size_t> res;
+    res.reserve(total);
+    for(const std::vector<size_t>& f : found)
+        res.insert(res.end(), f.begin(), f.end());
+
+    return res;
+}
@@ -0,0 +1,445 @@
+#pragma once
+
+#include "BasicString.hpp"
+
+#include <atomic>
+#include <new>
+
+//
+// An immutable string whose copies share one buffer, so copying is O(1)
+// and safe across threads.
+//
+// The buffer is a single allocation holding the characters and the null,
+// followed by the reference count (and the allocator) in what a BasicString
+// would see as spare capacity. So the buffer stays a valid BasicString
+// buffer: a uniquely owned one is handed over to a BasicString as is, and
+// a BasicString's one is taken over whenever it has room for the count.
+//
+// That room is control_room() chars of spare capacity, past the null. A
+// string built to its exact size has none, and is copied instead; one meant
+// to be shared is best reserved with the room from the start.
+//
+template<typename CharT,
+         typename Traits = std::char_traits<CharT>,
+         typename Allocator = std::allocator<CharT>>
+class SharedBasicString
+{
+    using string_type_ = BasicString<CharT, Traits, Allocator>;
+    using alloc_traits_ = std::allocator_traits<Allocator>;
+
+    static_assert( std::is_trivial_v<CharT> );
+
+    // what the comparison operators take, besides SharedBasicString: views,
+    // C strings...; a BasicString brings its own
+    template<typename T>
+    using if_comparable_ = std::enable_if_t<!std::is_same_v<T, SharedBasicString>
+                                         && !std::is_same_v<T, string_type_>
+                                         && std::is_convertible_v<const T&, BasicStringView<CharT, Traits>>, int>;
+
+public:
+    using value_type = CharT;
+    using traits_type = Traits;
+    using allocator_type = Allocator;
+    using view_type = BasicStringView<CharT, Traits>;
+
+    static constexpr size_t npos = -1;
+
+    SharedBasicString() = default;
+
+    SharedBasicString(const CharT* buf, size_t sz, const Allocator& alloc = Allocator())
+    {
+        // empty strings hold no buffer, unless it is needed to hold an
+        // allocator that cannot be defaulted
+        if(sz == 0u && std::is_default_constructible_v<Allocator>)
+            return;
+
+        Allocator a{alloc};
+        if(sz > alloc_traits_::max_size(a) - control_room_ - 1)
+            throw std::length_error("size too big");
+
+        size_t cap = sz + control_room_;
+        CharT* p = alloc_traits_::allocate(a, cap + 1);
+
+        Traits::copy(p, buf, sz);
+        Traits::assign(p[sz], CharT());
+
+        ::new(control_slot_(p, sz)) control_t{{1u}, cap, std::move(a)};
+        m_data = p;
+        m_size = sz;
+    }
+
+    SharedBasicString(const CharT* buf, const Allocator& alloc = Allocator())
+        : SharedBasicString(buf, Traits::length(buf), alloc)
+    {
+    }
+
+    explicit SharedBasicString(const string_type_& str)
+        : SharedBasicString(str.data(), str.size(),
+                            alloc_traits_::select_on_container_copy_construction(str.get_allocator()))
+    {
+    }
+
+    // takes over the buffer of str if it is on the heap and has
+    // control_room() chars to spare; copies it otherwise
+    explicit SharedBasicString(string_type_&& str)
+    {
+        if(str.is_long_() && control_fits_(str.data(), str.size(), str.capacity()))
+        {
+            size_t sz = str.size();
+            size_t cap = str.capacity();
+            Allocator a = str.get_allocator();
+            CharT* p = str.release_heap_();
+
+            ::new(control_slot_(p, sz)) control_t{{1u}, cap, std::move(a)};
+            m_data = p;
+            m_size = sz;
+        }
+        else
+        {
+            SharedBasicString tmp{str.data(), str.size(), str.get_allocator()};
+            swap(*this, tmp);
+        }
+    }
+
+    SharedBasicString(const SharedBasicString& rhs) noexcept
+        : m_data(rhs.m_data)
+        , m_size(rhs.m_size)
+    {
+        if(m_data != nullptr)
+            control_()->refs.fetch_add(1u, std::memory_order_relaxed);
+    }
+
+    SharedBasicString(SharedBasicString&& rhs) noexcept
+        : m_data(std::exchange(rhs.m_data, nullptr))
+        , m_size(std::exchange(rhs.m_size, 0u))
+    {
+    }
+
+    friend void swap(SharedBasicString& lhs, SharedBasicString& rhs) noexcept
+    {
+        using std::swap;
+
+        swap(lhs.m_data, rhs.m_data);
+        swap(lhs.m_size, rhs.m_size);
+    }
+
+    SharedBasicString& operator=(SharedBasicString rhs) noexcept
+    {
+        swap(*this, rhs);
+        return *this;
+    }
+
+    ~SharedBasicString()
+    {
+        if(m_data == nullptr)
+            return;
+
+        control_t* c = control_();
+        if(c->refs.fetch_sub(1u, std::memory_order_acq_rel) == 1u)
+        {
+            Allocator a = std::move(c->alloc);
+            size_t cap = c->capacity;
+
+            c->~control_t();
+            alloc_traits_::deallocate(a, m_data, cap + 1);
+        }
+    }
+
+    //////////////////////////
+
+    explicit operator string_type_() const&
+    {
+        return string_type_{data(), size(), get_allocator()};
+    }
+
+    // hands the buffer over when this is its only owner, copies otherwise;
+    // either way this is left empty
+    explicit operator string_type_() &&
+    {
+        if(m_data == nullptr || control_()->refs.load(std::memory_order_acquire) != 1u)
+        {
+            SharedBasicString tmp = std::move(*this);
+            return static_cast<string_type_>(tmp);
+        }
+
+        control_t* c = control_();
+        string_type_ res{c->alloc};
+        size_t cap = c->capacity;
+        c->~control_t();
+
+        res.adopt_heap_(std::exchange(m_data, nullptr), std::exchange(m_size, 0u), cap);
+        return res;
+    }
+
+    allocator_type get_allocator() const
+    {
+        if constexpr(std::is_default_constructible_v<Allocator>)
+        {
+            if(m_data == nullptr)
+                return Allocator();
+        }
+
+        assert(m_data != nullptr); // not a default constructed or moved-from one
+
+        return control_()->alloc;
+    }
+
+    // the spare capacity a BasicString needs for its buffer to be taken over
+    static constexpr size_t control_room()
+    {
+        return control_room_;
+    }
+
+    // number of SharedBasicString objects sharing the buffer (0 when empty)
+    size_t use_count() const
+    {
+        return m_data != nullptr ? control_()->refs.load(std::memory_order_relaxed) : 0u;
+    }
+
+    //////////////////////////
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return size() == 0u;
+    }
+
+    const CharT* data() const
+    {
+        static const CharT null = CharT();
+        return m_data != nullptr ? m_data : std::addressof(null);
+    }
+
+    const CharT* c_str() const
+    {
+        return data();
+    }
+
+    operator view_type() const noexcept
+    {
+        return view_type{data(), size()};
+    }
+
+    const CharT& operator[](size_t index) const
+    {
+        assert(index < size());
+
+        return data()[index];
+    }
+
+    const CharT& at(size_t index) const
+    {
+        if(index >= size())
+            throw std::out_of_range{"bad index"};
+
+        return data()[index];
+    }
+
+    const CharT& front() const
+    {
+        return (*this)[0];
+    }
+
+    const CharT& back() const
+    {
+        return (*this)[size() - 1];
+    }
+
+    //////////////////////////
+
+    string_type_ substr(size_t index = 0, size_t count = npos) const
+    {
+        if(index >= size())
+            throw std::out_of_range{"bad index"};
+
+        return string_type_{data() + index, std::min(size() - index, count), get_allocator()};
+    }
+
+    size_t find(const CharT* buf, size_t index, size_t sz) const
+    {
+        return string_type_::find_(data(), size(), buf, index, sz);
+    }
+
+    size_t find(const CharT* buf, size_t index = 0) const
+    {
+        return find(buf, index, Traits::length(buf));
+    }
+
+    size_t find(const string_type_& str, size_t index = 0) const
+    {
+        return find(str.data(), index, str.size());
+    }
+
+    size_t find(view_type str, size_t index = 0) const
+    {
+        return find(str.data(), index, str.size());
+    }
+
+    size_t find(const typename string_type_::searcher& s, size_t index = 0) const
+    {
+        if(index > size())
+            return npos;
+
+        size_t r = s.search(data() + index, size() - index);
+        return r == npos ? npos : index + r;
+    }
+
+    //
+    // Comparisons with shared strings, views and C strings, as BasicString
+    // has them; those with a BasicString are its own.
+    //
+    friend bool operator==(const SharedBasicString& lhs, const SharedBasicString& rhs)
+    {
+        return equal_(lhs, rhs);
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator==(const SharedBasicString& lhs, const T& rhs)
+    {
+        return equal_(lhs, rhs);
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator==(const T& lhs, const SharedBasicString& rhs)
+    {
+        return equal_(lhs, rhs);
+    }
+
+    friend bool operator!=(const SharedBasicString& lhs, const SharedBasicString& rhs)
+    {
+        return !equal_(lhs, rhs);
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator!=(const SharedBasicString& lhs, const T& rhs)
+    {
+        return !equal_(lhs, rhs);
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator!=(const T& lhs, const SharedBasicString& rhs)
+    {
+        return !equal_(lhs, rhs);
+    }
+
+    friend bool operator<(const SharedBasicString& lhs, const SharedBasicString& rhs)
+    {
+        return compare_(lhs, rhs) < 0;
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator<(const SharedBasicString& lhs, const T& rhs)
+    {
+        return compare_(lhs, rhs) < 0;
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator<(const T& lhs, const SharedBasicString& rhs)
+    {
+        return compare_(lhs, rhs) < 0;
+    }
+
+    friend bool operator<=(const SharedBasicString& lhs, const SharedBasicString& rhs)
+    {
+        return compare_(lhs, rhs) <= 0;
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator<=(const SharedBasicString& lhs, const T& rhs)
+    {
+        return compare_(lhs, rhs) <= 0;
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator<=(const T& lhs, const SharedBasicString& rhs)
+    {
+        return compare_(lhs, rhs) <= 0;
+    }
+
+    friend bool operator>(const SharedBasicString& lhs, const SharedBasicString& rhs)
+    {
+        return compare_(lhs, rhs) > 0;
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator>(const SharedBasicString& lhs, const T& rhs)
+    {
+        return compare_(lhs, rhs) > 0;
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator>(const T& lhs, const SharedBasicString& rhs)
+    {
+        return compare_(lhs, rhs) > 0;
+    }
+
+    friend bool operator>=(const SharedBasicString& lhs, const SharedBasicString& rhs)
+    {
+        return compare_(lhs, rhs) >= 0;
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator>=(const SharedBasicString& lhs, const T& rhs)
+    {
+        return compare_(lhs, rhs) >= 0;
+    }
+
+    template<typename T, if_comparable_<T> = 0>
+    friend bool operator>=(const T& lhs, const SharedBasicString& rhs)
+    {
+        return compare_(lhs, rhs) >= 0;
+    }
+
+private:
+    static bool equal_(view_type lhs, view_type rhs)
+    {
+        return string_type_::equal_(lhs, rhs);
+    }
+
+    static int compare_(view_type lhs, view_type rhs)
+    {
+        return string_type_::compare_(lhs, rhs);
+    }
+
+private:
+    struct control_t
+    {
+        std::atomic<size_t> refs;
+        size_t capacity; // of the whole buffer, as BasicString counts it
+        Allocator alloc;
+    };
+
+    // elements to reserve past the null, so that an aligned control_t fits
+    static constexpr size_t control_room_ =
+        (sizeof(control_t) + alignof(control_t) - 1 + sizeof(CharT) - 1) / sizeof(CharT);
+
+    static void* control_slot_(CharT* p, size_t sz)
+    {
+        void* slot = p + sz + 1;
+        size_t space = sizeof(control_t) + alignof(control_t) - 1;
+        return std::align(alignof(control_t), sizeof(control_t), slot, space);
+    }
+
+    static bool control_fits_(const CharT* p, size_t sz, size_t cap)
+    {
+        void* slot = const_cast<CharT*>(p + sz + 1);
+        size_t space = (cap - sz) * sizeof(CharT);
+        return std::align(alignof(control_t), sizeof(control_t), slot, space) != nullptr;
+    }
+
+    control_t* control_() const
+    {
+        return std::launder(static_cast<control_t*>(control_slot_(m_data, m_size)));
+    }
+
+private:
+    CharT* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+using SharedString = SharedBasicString<char>;
+using wSharedString = SharedBasicString<wchar_t>;
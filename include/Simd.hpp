@@ -0,0 +1,306 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#   define BASIC_STRING_SIMD_X86 1
+#   include <immintrin.h>
+#else
+#   define BASIC_STRING_SIMD_X86 0
+#endif
+
+//
+// Vectorized kernels over byte sequences, used by the char-sized
+// instantiations of BasicString. Every kernel has a portable scalar
+// version; the x86 ones are picked at runtime depending on the CPU.
+//
+namespace simd
+{
+    inline constexpr size_t npos = static_cast<size_t>(-1);
+
+    //
+    // Substring search. The scalar version hops between occurrences of the
+    // first needle byte with memchr. The vector versions compare the first
+    // and the last needle byte against a whole vector of candidate positions
+    // at once, and only the survivors of that filter get a full memcmp.
+    //
+    inline size_t find_scalar(const char* hay, size_t n, const char* needle, size_t m)
+    {
+        if(m == 0u) return 0u;
+        if(m > n) return npos;
+
+        const char* p = hay;
+        const char* last = hay + (n - m); // last candidate position
+        while(p <= last)
+        {
+            p = static_cast<const char*>(std::memchr(p, needle[0], last - p + 1));
+            if(p == nullptr)
+                break;
+
+            if(std::memcmp(p + 1, needle + 1, m - 1) == 0)
+                return p - hay;
+
+            ++p;
+        }
+
+        return npos;
+    }
+
+#if BASIC_STRING_SIMD_X86
+    inline size_t find_sse2(const char* hay, size_t n, const char* needle, size_t m)
+    {
+        if(m < 2u || m > n)
+            return find_scalar(hay, n, needle, m);
+
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last = _mm_set1_epi8(needle[m - 1]);
+
+        size_t i = 0u;
+        for(; i + m - 1 + 16 <= n; i += 16) // all 16 candidates fit
+        {
+            __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i));
+            __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i + m - 1));
+
+            unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first),
+                                                            _mm_cmpeq_epi8(last, block_last)));
+            while(mask != 0u)
+            {
+                unsigned bit = __builtin_ctz(mask);
+                if(std::memcmp(hay + i + bit + 1, needle + 1, m - 2) == 0)
+                    return i + bit;
+
+                mask &= mask - 1;
+            }
+        }
+
+        size_t r = find_scalar(hay + i, n - i, needle, m);
+        return r == npos ? npos : i + r;
+    }
+
+    __attribute__((target("avx2")))
+    inline size_t find_avx2(const char* hay, size_t n, const char* needle, size_t m)
+    {
+        if(m < 2u || m > n)
+            return find_scalar(hay, n, needle, m);
+
+        const __m256i first = _mm256_set1_epi8(needle[0]);
+        const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+
+        size_t i = 0u;
+        for(; i + m - 1 + 32 <= n; i += 32) // all 32 candidates fit
+        {
+            __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i));
+            __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i + m - 1));
+
+            unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first),
+                                                                  _mm256_cmpeq_epi8(last, block_last)));
+            while(mask != 0u)
+            {
+                unsigned bit = __builtin_ctz(mask);
+                if(std::memcmp(hay + i + bit + 1, needle + 1, m - 2) == 0)
+                    return i + bit;
+
+                mask &= mask - 1;
+            }
+        }
+
+        size_t r = find_sse2(hay + i, n - i, needle, m);
+        return r == npos ? npos : i + r;
+    }
+
+    inline bool has_avx2()
+    {
+        static const bool result = []
+        {
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") != 0;
+        }();
+
+        return result;
+    }
+#endif
+
+    inline size_t find(const char* hay, size_t n, const char* needle, size_t m)
+    {
+#if BASIC_STRING_SIMD_X86
+        return has_avx2() ? find_avx2(hay, n, needle, m) : find_sse2(hay, n, needle, m);
+#else
+        return find_scalar(hay, n, needle, m);
+#endif
+    }
+
+    //
+    // First position where a and b differ, if they do. Used for ordering
+    // wider chars: equality is a memcmp, but the order of their bytes is not
+    // that of the chars. The scalar version compares 8 bytes at a time.
+    //
+    inline size_t mismatch_scalar(const char* a, const char* b, size_t n)
+    {
+        size_t i = 0u;
+        for(; i + 8 <= n; i += 8)
+        {
+            if(std::memcmp(a + i, b + i, 8) != 0)
+                break;
+        }
+
+        for(; i < n; ++i)
+        {
+            if(a[i] != b[i])
+                return i;
+        }
+
+        return npos;
+    }
+
+#if BASIC_STRING_SIMD_X86
+    inline size_t mismatch_sse2(const char* a, const char* b, size_t n)
+    {
+        size_t i = 0u;
+        for(; i + 16 <= n; i += 16)
+        {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+
+            unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) ^ 0xffffu;
+            if(mask != 0u)
+                return i + __builtin_ctz(mask);
+        }
+
+        size_t r = mismatch_scalar(a + i, b + i, n - i);
+        return r == npos ? npos : i + r;
+    }
+
+    __attribute__((target("avx2")))
+    inline size_t mismatch_avx2(const char* a, const char* b, size_t n)
+    {
+        size_t i = 0u;
+        for(; i + 32 <= n; i += 32)
+        {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+
+            unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)));
+            if(mask != 0u)
+                return i + __builtin_ctz(mask);
+        }
+
+        size_t r = mismatch_sse2(a + i, b + i, n - i);
+        return r == npos ? npos : i + r;
+    }
+#endif
+
+    inline size_t mismatch(const char* a, const char* b, size_t n)
+    {
+#if BASIC_STRING_SIMD_X86
+        return has_avx2() ? mismatch_avx2(a, b, n) : mismatch_sse2(a, b, n);
+#else
+        return mismatch_scalar(a, b, n);
+#endif
+    }
+
+    //
+    // First position of any of the k bytes of set (the delimiter scan of
+    // split). A single byte is left to memchr. For sets of up to
+    // max_vector_set bytes, the vector versions compare a whole vector
+    // against each of them, and OR the results; larger ones are looked up
+    // a byte at a time in a table.
+    //
+    inline constexpr size_t max_vector_set = 8u;
+
+    inline size_t find_first_of_scalar(const char* hay, size_t n, const char* set, size_t k)
+    {
+        if(n == 0u) return npos;
+
+        if(k == 1u)
+        {
+            const void* p = std::memchr(hay, set[0], n);
+            return p != nullptr ? static_cast<const char*>(p) - hay : npos;
+        }
+
+        if(k <= max_vector_set)
+        {
+            for(size_t i = 0u; i < n; ++i)
+                if(std::memchr(set, hay[i], k) != nullptr)
+                    return i;
+
+            return npos;
+        }
+
+        bool table[256] = {};
+        for(size_t j = 0u; j < k; ++j)
+            table[static_cast<unsigned char>(set[j])] = true;
+
+        for(size_t i = 0u; i < n; ++i)
+            if(table[static_cast<unsigned char>(hay[i])])
+                return i;
+
+        return npos;
+    }
+
+#if BASIC_STRING_SIMD_X86
+    inline size_t find_first_of_sse2(const char* hay, size_t n, const char* set, size_t k)
+    {
+        if(k < 2u || k > max_vector_set)
+            return find_first_of_scalar(hay, n, set, k);
+
+        __m128i bytes[max_vector_set];
+        for(size_t j = 0u; j < k; ++j)
+            bytes[j] = _mm_set1_epi8(set[j]);
+
+        size_t i = 0u;
+        for(; i + 16 <= n; i += 16)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i));
+
+            __m128i hits = _mm_cmpeq_epi8(block, bytes[0]);
+            for(size_t j = 1u; j < k; ++j)
+                hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, bytes[j]));
+
+            unsigned mask = _mm_movemask_epi8(hits);
+            if(mask != 0u)
+                return i + __builtin_ctz(mask);
+        }
+
+        size_t r = find_first_of_scalar(hay + i, n - i, set, k);
+        return r == npos ? npos : i + r;
+    }
+
+    __attribute__((target("avx2")))
+    inline size_t find_first_of_avx2(const char* hay, size_t n, const char* set, size_t k)
+    {
+        if(k < 2u || k > max_vector_set)
+            return find_first_of_scalar(hay, n, set, k);
+
+        __m256i bytes[max_vector_set];
+        for(size_t j = 0u; j < k; ++j)
+            bytes[j] = _mm256_set1_epi8(set[j]);
+
+        size_t i = 0u;
+        for(; i + 32 <= n; i += 32)
+        {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i));
+
+            __m256i hits = _mm256_cmpeq_epi8(block, bytes[0]);
+            for(size_t j = 1u; j < k; ++j)
+                hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, bytes[j]));
+
+            unsigned mask = _mm256_movemask_epi8(hits);
+            if(mask != 0u)
+                return i + __builtin_ctz(mask);
+        }
+
+        size_t r = find_first_of_sse2(hay + i, n - i, set, k);
+        return r == npos ? npos : i + r;
+    }
+#endif
+
+    inline size_t find_first_of(const char* hay, size_t n, const char* set, size_t k)
+    {
+#if BASIC_STRING_SIMD_X86
+        return has_avx2() ? find_first_of_avx2(hay, n, set, k) : find_first_of_sse2(hay, n, set, k);
+#else
+        return find_first_of_scalar(hay, n, set, k);
+#endif
+    }
+}
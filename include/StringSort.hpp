@@ -0,0 +1,359 @@
+#pragma once
+
+#include "BasicString.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//
+// Sorting of large collections of strings, or views: string_sort(first,
+// last) puts them in the order of operator<, as std::sort would, and
+// parallel_string_sort() does the same on several threads. Neither is
+// stable.
+//
+// std::sort follows the data pointer of both strings on every comparison,
+// and compares from their first char on, though the prefixes they share
+// are already known to be equal. Here the strings are instead first
+// described by an array of entries - data pointer, size, and a key holding
+// the next few chars from the depth being sorted on - and the entries are
+// sorted by multikey quicksort (Bentley and Sedgewick): a 3-way partition
+// on the keys, with the equal part going on to the next chars. Most steps
+// compare the cached keys only, and each buffer is read once per few chars
+// of depth, in order. The strings themselves are moved into place once, at
+// the end.
+//
+// The keys take up to 7 bytes of chars and the number of chars, so they
+// order as the chars do. Integral chars of up to 4 bytes, with the standard
+// traits, are sorted so; others fall back to a comparison sort over the
+// entries.
+//
+namespace string_sorting
+{
+    template<typename T>
+    struct view_of_
+    {
+        using type = typename T::view_type;
+    };
+
+    template<typename CharT, typename Traits>
+    struct view_of_<BasicStringView<CharT, Traits>>
+    {
+        using type = BasicStringView<CharT, Traits>;
+    };
+
+    template<typename View>
+    class sorter
+    {
+        using CharT = typename View::value_type;
+        using Traits = typename View::traits_type;
+
+    public:
+        static constexpr bool keyed = std::is_integral_v<CharT>
+                                   && sizeof(CharT) <= 4u
+                                   && std::is_same_v<Traits, std::char_traits<CharT>>;
+
+        // chars per key; the low byte of the key has how many there are
+        static constexpr size_t key_chars = keyed ? 7u / sizeof(CharT) : 0u;
+
+        struct entry_t
+        {
+            uint64_t key;
+            const CharT* data;
+            size_t size;
+            size_t index; // in the input
+        };
+
+        // a range of entries, which agree on their first depth chars
+        struct task_t
+        {
+            size_t lo;
+            size_t hi;
+            size_t depth;
+        };
+
+        static entry_t make_entry(View str, size_t index)
+        {
+            entry_t e{0u, str.data(), str.size(), index};
+            e.key = key_at_(e, 0u);
+            return e;
+        }
+
+        // sorts the entries of t
+        static void sort(entry_t* entries, task_t t)
+        {
+            if constexpr(!keyed)
+            {
+                std::sort(entries + t.lo, entries + t.hi, [](const entry_t& a, const entry_t& b)
+                {
+                    return View{a.data, a.size}.compare(View{b.data, b.size}) < 0;
+                });
+            }
+            else
+            {
+                std::vector<task_t> tasks{t};
+                while(!tasks.empty())
+                {
+                    task_t next = tasks.back();
+                    tasks.pop_back();
+                    step(entries, next, tasks);
+                }
+            }
+        }
+
+        // sorts the entries of t if there are few, or else partitions them,
+        // adding the parts that still need sorting to out
+        static void step(entry_t* entries, task_t t, std::vector<task_t>& out)
+        {
+            entry_t* a = entries + t.lo;
+            size_t n = t.hi - t.lo;
+
+            if(n <= small_)
+            {
+                for(size_t i = 1u; i < n; ++i)
+                {
+                    entry_t e = a[i];
+                    size_t j = i;
+                    for(; j > 0u && less_(e, a[j - 1], t.depth); --j)
+                        a[j] = a[j - 1];
+
+                    a[j] = e;
+                }
+
+                return;
+            }
+
+            uint64_t pivot = median_(a[0].key, a[n / 2u].key, a[n - 1u].key);
+
+            size_t lt = 0u;
+            size_t gt = n;
+            for(size_t i = 0u; i < gt; )
+            {
+                if(a[i].key < pivot)
+                    std::swap(a[lt++], a[i++]);
+                else if(a[i].key > pivot)
+                    std::swap(a[i], a[--gt]);
+                else
+                    ++i;
+            }
+
+            if(lt > 1u)
+                out.push_back(task_t{t.lo, t.lo + lt, t.depth});
+
+            if(n - gt > 1u)
+                out.push_back(task_t{t.lo + gt, t.hi, t.depth});
+
+            // the equal ones go on to the next chars, unless they have all ended
+            if(gt - lt > 1u && (pivot & 0xffu) == key_chars)
+            {
+                size_t depth = t.depth + key_chars;
+                for(size_t i = lt; i < gt; ++i)
+                    a[i].key = key_at_(a[i], depth);
+
+                out.push_back(task_t{t.lo + lt, t.lo + gt, depth});
+            }
+        }
+
+    private:
+        static constexpr size_t small_ = 16u;
+
+        // of the char, as an unsigned value in the order of Traits::lt
+        static uint64_t code_(CharT ch)
+        {
+            using U = std::make_unsigned_t<CharT>;
+
+            U u = static_cast<U>(ch);
+            if constexpr(sizeof(CharT) > 1u && std::is_signed_v<CharT>)
+                u ^= U(1) << (sizeof(CharT) * 8u - 1u);
+
+            return u;
+        }
+
+        static uint64_t key_at_(const entry_t& e, size_t depth)
+        {
+            if constexpr(!keyed)
+            {
+                return 0u;
+            }
+            else
+            {
+                size_t count = e.size > depth ? std::min(e.size - depth, key_chars) : 0u;
+
+                uint64_t key = 0u;
+                for(size_t i = 0u; i < key_chars; ++i)
+                    key = (key << (sizeof(CharT) * 8u)) | (i < count ? code_(e.data[depth + i]) : 0u);
+
+                return (key << 8) | count;
+            }
+        }
+
+        // given the keys at depth
+        static bool less_(const entry_t& a, const entry_t& b, size_t depth)
+        {
+            if(a.key != b.key)
+                return a.key < b.key;
+
+            if((a.key & 0xffu) < key_chars)
+                return false; // both ended, the same
+
+            depth += key_chars;
+            return View{a.data + depth, a.size - depth}.compare(View{b.data + depth, b.size - depth}) < 0;
+        }
+
+        static uint64_t median_(uint64_t a, uint64_t b, uint64_t c)
+        {
+            return std::max(std::min(a, b), std::min(std::max(a, b), c));
+        }
+    };
+
+    // moves the elements to where the sorted entries say
+    template<typename It, typename Entry>
+    void permute_(It first, std::vector<Entry>& entries)
+    {
+        for(size_t i = 0u; i < entries.size(); ++i)
+        {
+            if(entries[i].index == i)
+                continue;
+
+            auto tmp = std::move(first[i]);
+
+            size_t j = i;
+            for(;;)
+            {
+                size_t k = std::exchange(entries[j].index, j);
+                if(k == i)
+                {
+                    first[j] = std::move(tmp);
+                    break;
+                }
+
+                first[j] = std::move(first[k]);
+                j = k;
+            }
+        }
+    }
+
+    // runs f(i) for i in [0, count) on up to threads threads, and rethrows the first exception
+    template<typename F>
+    void parallel_for_(size_t count, size_t threads, F f)
+    {
+        std::atomic<size_t> next{0u};
+        std::exception_ptr error;
+        std::atomic<bool> failed{false};
+
+        auto work = [&]
+        {
+            try
+            {
+                for(size_t i; (i = next.fetch_add(1u, std::memory_order_relaxed)) < count; )
+                    f(i);
+            }
+            catch(...)
+            {
+                if(!failed.exchange(true))
+                    error = std::current_exception();
+
+                next.store(count, std::memory_order_relaxed);
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for(size_t t = 1u; t < std::min(threads, count); ++t)
+            pool.emplace_back(work);
+
+        work();
+        for(std::thread& t : pool)
+            t.join();
+
+        if(error)
+            std::rethrow_exception(error);
+    }
+}
+
+template<typename It>
+void string_sort(It first, It last)
+{
+    using view_type = typename string_sorting::view_of_<typename std::iterator_traits<It>::value_type>::type;
+    using sorter = string_sorting::sorter<view_type>;
+    using entry_t = typename sorter::entry_t;
+
+    size_t n = last - first;
+    if(n < 2u)
+        return;
+
+    std::vector<entry_t> entries;
+    entries.reserve(n);
+    for(size_t i = 0u; i < n; ++i)
+        entries.push_back(sorter::make_entry(first[i], i));
+
+    sorter::sort(entries.data(), typename sorter::task_t{0u, n, 0u});
+
+    string_sorting::permute_(first, entries);
+}
+
+//
+// The entries are made on all the threads; the ranges bigger than a share
+// of a thread are then partitioned on this one, and what is left is sorted
+// on all of them, the biggest ranges first. threads = 0 is one per core.
+//
+template<typename It>
+void parallel_string_sort(It first, It last, size_t threads = 0u)
+{
+    using view_type = typename string_sorting::view_of_<typename std::iterator_traits<It>::value_type>::type;
+    using sorter = string_sorting::sorter<view_type>;
+    using entry_t = typename sorter::entry_t;
+    using task_t = typename sorter::task_t;
+
+    constexpr size_t min_share = 4096u; // of a thread, to be worth starting it
+
+    if(threads == 0u)
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    size_t n = last - first;
+    threads = std::min(threads, n / min_share);
+    if(threads < 2u || !sorter::keyed)
+    {
+        string_sort(first, last);
+        return;
+    }
+
+    std::vector<entry_t> entries(n);
+    size_t slices = threads * 4u;
+    string_sorting::parallel_for_(slices, threads, [&](size_t s)
+    {
+        for(size_t i = n * s / slices; i < n * (s + 1u) / slices; ++i)
+            entries[i] = sorter::make_entry(first[i], i);
+    });
+
+    std::vector<task_t> pending{task_t{0u, n, 0u}};
+    std::vector<task_t> ready;
+
+    size_t share = std::max(n / (threads * 8u), min_share);
+    while(!pending.empty())
+    {
+        task_t t = pending.back();
+        pending.pop_back();
+
+        if(t.hi - t.lo <= share)
+            ready.push_back(t);
+        else
+            sorter::step(entries.data(), t, pending);
+    }
+
+    std::sort(ready.begin(), ready.end(), [](const task_t& a, const task_t& b)
+    {
+        return a.hi - a.lo > b.hi - b.lo;
+    });
+
+    string_sorting::parallel_for_(ready.size(), threads, [&](size_t i)
+    {
+        sorter::sort(entries.data(), ready[i]);
+    });
+
+    string_sorting::permute_(first, entries);
+}
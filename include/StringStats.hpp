@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+//
+// Totals kept by StringStats, over all threads.
+//
+struct StringStatsSnapshot
+{
+    size_t allocations = 0u;
+    size_t deallocations = 0u;
+    size_t growths = 0u;          // reallocations to a larger buffer
+    size_t bytes_copied = 0u;
+    size_t peak_capacity = 0u;    // in bytes, of the largest buffer allocated
+};
+
+//
+// An instrumentation policy for BasicString that counts what the hooks
+// report, e.g.
+//
+//   struct ParserTag {};
+//   using ParserString = BasicString<char, std::char_traits<char>,
+//                                    std::allocator<char>, StringStats<ParserTag>>;
+//   ...
+//   StringStatsSnapshot s = StringStats<ParserTag>::snapshot();
+//
+// Each Tag gets counters of its own, so string types can be told apart.
+//
+// A thread only ever writes counters of its own, with plain (relaxed) loads
+// and stores, so counting costs no locked instructions. They are summed up
+// on demand by snapshot(); those of threads that have exited are folded
+// into a common total as they exit.
+//
+template<typename Tag = void>
+class StringStats
+{
+public:
+    static void on_allocate(size_t bytes)
+    {
+        counters_t& c = local_();
+        bump_(c.allocations, 1u);
+        if(bytes > c.peak_capacity.load(std::memory_order_relaxed))
+            c.peak_capacity.store(bytes, std::memory_order_relaxed);
+    }
+
+    static void on_deallocate(size_t /* bytes */)
+    {
+        bump_(local_().deallocations, 1u);
+    }
+
+    static void on_grow(size_t /* old_bytes */, size_t /* new_bytes */)
+    {
+        bump_(local_().growths, 1u);
+    }
+
+    static void on_copy(size_t bytes)
+    {
+        bump_(local_().bytes_copied, bytes);
+    }
+
+    //////////////////////////
+
+    // the counts of all threads, live or exited
+    static StringStatsSnapshot snapshot()
+    {
+        registry_t& r = registry_();
+        std::lock_guard<std::mutex> lock{r.mutex};
+
+        StringStatsSnapshot res = r.retired;
+        for(const counters_t* c : r.live)
+            c->add_to(res);
+
+        return res;
+    }
+
+    // zeroes the counts; not to be called while other threads are counting
+    static void reset()
+    {
+        registry_t& r = registry_();
+        std::lock_guard<std::mutex> lock{r.mutex};
+
+        r.retired = StringStatsSnapshot{};
+        for(counters_t* c : r.live)
+            c->clear();
+    }
+
+private:
+    struct counters_t
+    {
+        std::atomic<size_t> allocations{0u};
+        std::atomic<size_t> deallocations{0u};
+        std::atomic<size_t> growths{0u};
+        std::atomic<size_t> bytes_copied{0u};
+        std::atomic<size_t> peak_capacity{0u};
+
+        void add_to(StringStatsSnapshot& s) const
+        {
+            s.allocations += allocations.load(std::memory_order_relaxed);
+            s.deallocations += deallocations.load(std::memory_order_relaxed);
+            s.growths += growths.load(std::memory_order_relaxed);
+            s.bytes_copied += bytes_copied.load(std::memory_order_relaxed);
+            s.peak_capacity = std::max(s.peak_capacity, peak_capacity.load(std::memory_order_relaxed));
+        }
+
+        void clear()
+        {
+            allocations.store(0u, std::memory_order_relaxed);
+            deallocations.store(0u, std::memory_order_relaxed);
+            growths.store(0u, std::memory_order_relaxed);
+            bytes_copied.store(0u, std::memory_order_relaxed);
+            peak_capacity.store(0u, std::memory_order_relaxed);
+        }
+    };
+
+    struct registry_t
+    {
+        std::mutex mutex;
+        std::vector<counters_t*> live;
+        StringStatsSnapshot retired;
+    };
+
+    // registers itself for the lifetime of the thread
+    struct thread_counters_t : counters_t
+    {
+        thread_counters_t()
+        {
+            registry_t& r = registry_();
+            std::lock_guard<std::mutex> lock{r.mutex};
+            r.live.push_back(this);
+        }
+
+        ~thread_counters_t()
+        {
+            registry_t& r = registry_();
+            std::lock_guard<std::mutex> lock{r.mutex};
+            this->add_to(r.retired);
+            r.live.erase(std::find(r.live.begin(), r.live.end(), this));
+        }
+    };
+
+    static void bump_(std::atomic<size_t>& counter, size_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static registry_t& registry_()
+    {
+        static registry_t r;
+        return r;
+    }
+
+    static counters_t& local_()
+    {
+        thread_local thread_counters_t c;
+        return c;
+    }
+};
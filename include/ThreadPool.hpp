@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//
+// A fixed set of worker threads for data-parallel loops: for_each_index(n, f)
+// runs f(0), ..., f(n - 1) on the workers and the calling thread, in no
+// particular order, and returns when all are done. The workers sleep in
+// between.
+//
+// Loops from several threads at once take turns; one started from inside
+// a loop of the same pool would deadlock.
+//
+class ThreadPool
+{
+public:
+    // threads counts the calling thread; 0 is one per core
+    explicit ThreadPool(size_t threads = 0u)
+    {
+        if(threads == 0u)
+            threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+        for(size_t i = 1u; i < threads; ++i)
+            m_workers.emplace_back([this] { work_(); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_stop = true;
+        }
+
+        m_wake.notify_all();
+        for(std::thread& t : m_workers)
+            t.join();
+    }
+
+    // one per core, made on first use
+    static ThreadPool& shared()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    // the number of threads a loop runs on, the calling one included
+    size_t size() const
+    {
+        return m_workers.size() + 1u;
+    }
+
+    // rethrows the first exception f throws, if any; the indices not started by then are skipped
+    template<typename F>
+    void for_each_index(size_t count, F&& f)
+    {
+        if(count == 0u)
+            return;
+
+        std::function<void(size_t)> fn = std::ref(f);
+        job_t job{&fn, count};
+
+        std::lock_guard<std::mutex> turn{m_turn};
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_job = &job;
+            ++m_generation;
+        }
+
+        m_wake.notify_all();
+        run_(job);
+
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_idle.wait(lock, [this] { return m_busy == 0u; });
+            m_job = nullptr;
+        }
+
+        if(job.error)
+            std::rethrow_exception(job.error);
+    }
+
+private:
+    struct job_t
+    {
+        job_t(const std::function<void(size_t)>* f, size_t n)
+            : fn(f)
+            , count(n)
+        {
+        }
+
+        const std::function<void(size_t)>* fn;
+        size_t count;
+        std::atomic<size_t> next{0u};
+
+        std::mutex error_mutex;
+        std::exception_ptr error;
+    };
+
+    static void run_(job_t& job)
+    {
+        for(size_t i; (i = job.next.fetch_add(1u, std::memory_order_relaxed)) < job.count; )
+        {
+            try
+            {
+                (*job.fn)(i);
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock{job.error_mutex};
+                if(!job.error)
+                    job.error = std::current_exception();
+
+                job.next.store(job.count, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void work_()
+    {
+        size_t seen = 0u;
+
+        std::unique_lock<std::mutex> lock{m_mutex};
+        for(;;)
+        {
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+            if(m_stop)
+                return;
+
+            seen = m_generation;
+            job_t* job = m_job;
+            if(job == nullptr)
+                continue; // woke up after that loop was over
+
+            ++m_busy;
+            lock.unlock();
+
+            run_(*job);
+
+            lock.lock();
+            if(--m_busy == 0u)
+                m_idle.notify_all();
+        }
+    }
+
+private:
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_turn; // of the loops
+
+    std::mutex m_mutex; // for the rest
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    job_t* m_job = nullptr;
+    size_t m_generation = 0u;
+    size_t m_busy = 0u; // workers in the current loop
+    bool m_stop = false;
+};
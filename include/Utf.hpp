@@ -0,0 +1,567 @@
+#pragma once
+
+#include "BasicString.hpp"
+#include "Simd.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+//
+// UTF-8 validation, and transcoding between UTF-8 in a String and UTF-16
+// or UTF-32 in a BasicString<char16_t>, BasicString<char32_t> or wString
+// (UTF-16 where wchar_t has 2 bytes, UTF-32 where it has 4).
+//
+// Validation is that of Keiser and Lemire ("Validating UTF-8 In Less Than
+// One Instruction Per Byte"): with AVX2, three table lookups on the nibbles
+// of each byte and the one before it classify every error there is, 32
+// bytes at a time, and blocks of ASCII are skipped with a single test.
+//
+// A conversion makes three passes over its input: it validates, counts the
+// output to allocate it exactly once, and then decodes, copying runs of
+// ASCII 16 chars at a time. Invalid input - overlong forms, surrogates,
+// code points past U+10FFFF, truncated sequences - throws std::range_error,
+// as std::wstring_convert does.
+//
+namespace utf
+{
+    //
+    // Scalar versions, for the tails and for other CPUs.
+    //
+
+    // whether the 8 bytes at p are all ASCII
+    inline bool ascii8_(const unsigned char* p)
+    {
+        uint64_t w;
+        std::memcpy(&w, p, 8);
+        return (w & 0x8080808080808080ull) == 0u;
+    }
+
+    inline bool validate_utf8_scalar(const unsigned char* p, size_t n)
+    {
+        size_t i = 0u;
+        while(i < n)
+        {
+            if(i + 8u <= n && ascii8_(p + i))
+            {
+                i += 8u;
+                continue;
+            }
+
+            uint32_t c = p[i];
+            if(c < 0x80u)
+            {
+                ++i;
+                continue;
+            }
+
+            size_t len;
+            uint32_t min;
+            if((c & 0xe0u) == 0xc0u)
+            {
+                len = 2u, min = 0x80u, c &= 0x1fu;
+            }
+            else if((c & 0xf0u) == 0xe0u)
+            {
+                len = 3u, min = 0x800u, c &= 0x0fu;
+            }
+            else if((c & 0xf8u) == 0xf0u)
+            {
+                len = 4u, min = 0x10000u, c &= 0x07u;
+            }
+            else
+            {
+                return false;
+            }
+
+            if(n - i < len)
+                return false;
+
+            for(size_t k = 1u; k < len; ++k)
+            {
+                if((p[i + k] & 0xc0u) != 0x80u)
+                    return false;
+
+                c = (c << 6) | (p[i + k] & 0x3fu);
+            }
+
+            if(c < min || c > 0x10ffffu || (c >= 0xd800u && c <= 0xdfffu))
+                return false;
+
+            i += len;
+        }
+
+        return true;
+    }
+
+    // code points (bytes that do not continue one), and those of 4 bytes
+    inline void count_utf8_scalar(const unsigned char* p, size_t n, size_t& points, size_t& quads)
+    {
+        for(size_t i = 0u; i < n; ++i)
+        {
+            points += (p[i] & 0xc0u) != 0x80u;
+            quads += p[i] >= 0xf0u;
+        }
+    }
+
+#if BASIC_STRING_SIMD_X86
+    //
+    // The error flags of the lookups; a pair of bytes is in error when the
+    // three lookups share one.
+    //
+    inline constexpr uint8_t too_short_ = 1u << 0;  // 11______ 0_______, 11______ 11______
+    inline constexpr uint8_t too_long_ = 1u << 1;   // 0_______ 10______
+    inline constexpr uint8_t overlong_3_ = 1u << 2; // 11100000 100_____
+    inline constexpr uint8_t too_large_ = 1u << 3;  // 11110100 1001____, 11110100 101_____, 111101__ 10______...
+    inline constexpr uint8_t surrogate_ = 1u << 4;  // 11101101 101_____
+    inline constexpr uint8_t overlong_2_ = 1u << 5; // 1100000_ 10______
+    inline constexpr uint8_t too_large_1000_ = 1u << 6; // 11110101 1000____, and up
+    inline constexpr uint8_t overlong_4_ = 1u << 6; // 11110000 1000____
+    inline constexpr uint8_t two_conts_ = 1u << 7;  // 10______ 10______, unless the third or fourth of a sequence
+    inline constexpr uint8_t carry_ = too_short_ | too_long_ | two_conts_;
+
+    template<int N>
+    __attribute__((target("avx2")))
+    inline __m256i prev_(__m256i input, __m256i prev_input)
+    {
+        return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev_input, input, 0x21), 16 - N);
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i lookup_(const uint8_t (&table)[16], __m256i nibbles)
+    {
+        __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table));
+        return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(t), nibbles);
+    }
+
+    // the errors of the bytes of input, which follow those of prev_input
+    __attribute__((target("avx2")))
+    inline __m256i check_block_(__m256i input, __m256i prev_input)
+    {
+        static constexpr uint8_t byte_1_high[16] = {
+            // 0_______
+            too_long_, too_long_, too_long_, too_long_, too_long_, too_long_, too_long_, too_long_,
+            // 10______
+            two_conts_, two_conts_, two_conts_, two_conts_,
+            // 1100____
+            too_short_ | overlong_2_,
+            // 1101____
+            too_short_,
+            // 1110____
+            too_short_ | overlong_3_ | surrogate_,
+            // 1111____
+            too_short_ | too_large_ | too_large_1000_ | overlong_4_
+        };
+
+        static constexpr uint8_t byte_1_low[16] = {
+            carry_ | overlong_3_ | overlong_2_ | overlong_4_, // ____0000
+            carry_ | overlong_2_,                            // ____0001
+            carry_, carry_,                                  // ____001_
+            carry_ | too_large_,                             // ____0100
+            carry_ | too_large_ | too_large_1000_,           // ____0101
+            carry_ | too_large_ | too_large_1000_,           // ____011_
+            carry_ | too_large_ | too_large_1000_,
+            carry_ | too_large_ | too_large_1000_,           // ____1___
+            carry_ | too_large_ | too_large_1000_,
+            carry_ | too_large_ | too_large_1000_,
+            carry_ | too_large_ | too_large_1000_,
+            carry_ | too_large_ | too_large_1000_,
+            carry_ | too_large_ | too_large_1000_ | surrogate_, // ____1101
+            carry_ | too_large_ | too_large_1000_,           // ____111_
+            carry_ | too_large_ | too_large_1000_
+        };
+
+        static constexpr uint8_t byte_2_high[16] = {
+            // 0_______
+            too_short_, too_short_, too_short_, too_short_, too_short_, too_short_, too_short_, too_short_,
+            // 1000____
+            too_long_ | overlong_2_ | two_conts_ | overlong_3_ | too_large_1000_ | overlong_4_,
+            // 1001____
+            too_long_ | overlong_2_ | two_conts_ | overlong_3_ | too_large_,
+            // 101_____
+            too_long_ | overlong_2_ | two_conts_ | surrogate_ | too_large_,
+            too_long_ | overlong_2_ | two_conts_ | surrogate_ | too_large_,
+            // 11______
+            too_short_, too_short_, too_short_, too_short_
+        };
+
+        const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+
+        __m256i prev1 = prev_<1>(input, prev_input);
+        __m256i special = _mm256_and_si256(
+            _mm256_and_si256(
+                lookup_(byte_1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble)),
+                lookup_(byte_1_low, _mm256_and_si256(prev1, low_nibble))),
+            lookup_(byte_2_high, _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble)));
+
+        // two continuations in a row are fine as the third or fourth byte of a sequence, and needed there
+        __m256i third = _mm256_subs_epu8(prev_<2>(input, prev_input), _mm256_set1_epi8(char(0xe0u - 0x80u)));
+        __m256i fourth = _mm256_subs_epu8(prev_<3>(input, prev_input), _mm256_set1_epi8(char(0xf0u - 0x80u)));
+        __m256i must_continue = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(char(0x80u)));
+
+        return _mm256_xor_si256(must_continue, special);
+    }
+
+    // the state of the validation, between blocks
+    struct validation_t
+    {
+        __m256i error;
+        __m256i prev_input;
+        __m256i prev_incomplete; // the bytes that start a sequence the block does not finish
+    };
+
+    __attribute__((target("avx2")))
+    inline void validate_block_(validation_t& v, __m256i input)
+    {
+        // of the last three bytes, the thresholds of starting a sequence too long for the block
+        const __m256i incomplete_above = _mm256_setr_epi8(
+            char(255), char(255), char(255), char(255), char(255), char(255), char(255), char(255),
+            char(255), char(255), char(255), char(255), char(255), char(255), char(255), char(255),
+            char(255), char(255), char(255), char(255), char(255), char(255), char(255), char(255),
+            char(255), char(255), char(255), char(255), char(255),
+            char(0xf0u - 1u), char(0xe0u - 1u), char(0xc0u - 1u));
+
+        if(_mm256_movemask_epi8(input) == 0)
+        {
+            v.error = _mm256_or_si256(v.error, v.prev_incomplete);
+            v.prev_incomplete = _mm256_setzero_si256();
+        }
+        else
+        {
+            v.error = _mm256_or_si256(v.error, check_block_(input, v.prev_input));
+            v.prev_incomplete = _mm256_subs_epu8(input, incomplete_above);
+        }
+
+        v.prev_input = input;
+    }
+
+    __attribute__((target("avx2")))
+    inline bool validate_utf8_avx2(const unsigned char* p, size_t n)
+    {
+        validation_t v{_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+
+        size_t i = 0u;
+        for(; i + 32u <= n; i += 32u)
+        {
+            validate_block_(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+
+            // an early way out, checked now and then
+            if((i & 1023u) == 992u && !_mm256_testz_si256(v.error, v.error))
+                return false;
+        }
+
+        if(i < n)
+        {
+            unsigned char tail[32] = {}; // padded with ASCII
+            std::memcpy(tail, p + i, n - i);
+            validate_block_(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tail)));
+        }
+
+        v.error = _mm256_or_si256(v.error, v.prev_incomplete);
+        return _mm256_testz_si256(v.error, v.error);
+    }
+
+    __attribute__((target("avx2")))
+    inline void count_utf8_avx2(const unsigned char* p, size_t n, size_t& points, size_t& quads)
+    {
+        const __m256i last_cont = _mm256_set1_epi8(char(0xbfu)); // as signed, continuations are the least
+        const __m256i quad_lead = _mm256_set1_epi8(char(0xf0u));
+
+        size_t i = 0u;
+        for(; i + 32u <= n; i += 32u)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+
+            unsigned starts = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(v, last_cont)));
+            unsigned leads = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(v, quad_lead), v)));
+
+            points += __builtin_popcount(starts);
+            quads += __builtin_popcount(leads);
+        }
+
+        count_utf8_scalar(p + i, n - i, points, quads);
+    }
+#endif
+
+    inline bool validate_utf8(const unsigned char* p, size_t n)
+    {
+#if BASIC_STRING_SIMD_X86
+        return simd::has_avx2() ? validate_utf8_avx2(p, n) : validate_utf8_scalar(p, n);
+#else
+        return validate_utf8_scalar(p, n);
+#endif
+    }
+
+    inline void count_utf8(const unsigned char* p, size_t n, size_t& points, size_t& quads)
+    {
+#if BASIC_STRING_SIMD_X86
+        if(simd::has_avx2())
+            return count_utf8_avx2(p, n, points, quads);
+#endif
+        count_utf8_scalar(p, n, points, quads);
+    }
+
+    //
+    // Decoding of valid UTF-8, into units of 2 bytes (UTF-16) or 4 (UTF-32).
+    //
+
+    // copies the ASCII chars at p, while there are 16 in a row, and returns how many
+    template<typename Unit>
+    size_t widen_ascii_(const unsigned char* p, size_t n, Unit* out)
+    {
+        size_t i = 0u;
+#if BASIC_STRING_SIMD_X86
+        const __m128i zero = _mm_setzero_si128();
+        for(; i + 16u <= n; i += 16u)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            if(_mm_movemask_epi8(v) != 0)
+                break;
+
+            __m128i lo = _mm_unpacklo_epi8(v, zero);
+            __m128i hi = _mm_unpackhi_epi8(v, zero);
+            if constexpr(sizeof(Unit) == 2u)
+            {
+                std::memcpy(out + i, &lo, 16);
+                std::memcpy(out + i + 8, &hi, 16);
+            }
+            else
+            {
+                __m128i w[4] = {
+                    _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+                    _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero)
+                };
+                std::memcpy(out + i, w, 64);
+            }
+        }
+#else
+        for(; i + 16u <= n && ascii8_(p + i) && ascii8_(p + i + 8u); i += 16u)
+        {
+            for(size_t k = 0u; k < 16u; ++k)
+                out[i + k] = static_cast<Unit>(p[i + k]);
+        }
+#endif
+        return i;
+    }
+
+    template<typename Unit>
+    Unit* decode_utf8_(const unsigned char* p, size_t n, Unit* out)
+    {
+        static_assert( sizeof(Unit) == 2u || sizeof(Unit) == 4u );
+
+        size_t i = 0u;
+        while(i < n)
+        {
+            size_t ascii = widen_ascii_(p + i, n - i, out);
+            i += ascii;
+            out += ascii;
+
+            // up to the next run of ASCII, a code point at a time
+            for(size_t stop = std::min(n, i + 16u); i < stop; )
+            {
+                uint32_t c = p[i];
+                if(c < 0x80u)
+                {
+                    i += 1u;
+                }
+                else if(c < 0xe0u)
+                {
+                    c = ((c & 0x1fu) << 6) | (p[i + 1] & 0x3fu);
+                    i += 2u;
+                }
+                else if(c < 0xf0u)
+                {
+                    c = ((c & 0x0fu) << 12) | ((p[i + 1] & 0x3fu) << 6) | (p[i + 2] & 0x3fu);
+                    i += 3u;
+                }
+                else
+                {
+                    c = ((c & 0x07u) << 18) | ((p[i + 1] & 0x3fu) << 12) | ((p[i + 2] & 0x3fu) << 6) | (p[i + 3] & 0x3fu);
+                    i += 4u;
+
+                    if constexpr(sizeof(Unit) == 2u)
+                    {
+                        c -= 0x10000u;
+                        *out++ = static_cast<Unit>(0xd800u + (c >> 10));
+                        c = 0xdc00u + (c & 0x3ffu);
+                    }
+                }
+
+                *out++ = static_cast<Unit>(c);
+            }
+        }
+
+        return out;
+    }
+
+    //
+    // Encoding of UTF-16 or UTF-32 units into UTF-8; the size is checked first,
+    // which validates the input too.
+    //
+
+    // of the code point at p[i], which is advanced past it; 0 if it is not valid
+    template<typename Unit>
+    uint32_t next_point_(const Unit* p, size_t n, size_t& i)
+    {
+        uint32_t c = static_cast<uint32_t>(p[i++]);
+        if constexpr(sizeof(Unit) == 2u)
+        {
+            c &= 0xffffu;
+            if(c >= 0xd800u && c <= 0xdfffu)
+            {
+                uint32_t low = i < n ? static_cast<uint32_t>(p[i]) & 0xffffu : 0u;
+                if(c > 0xdbffu || low < 0xdc00u || low > 0xdfffu)
+                    return 0xffffffffu;
+
+                ++i;
+                c = 0x10000u + ((c - 0xd800u) << 10) + (low - 0xdc00u);
+            }
+        }
+        else if(c > 0x10ffffu || (c >= 0xd800u && c <= 0xdfffu))
+        {
+            return 0xffffffffu;
+        }
+
+        return c;
+    }
+
+    // the size in UTF-8, or npos if the input is not valid
+    template<typename Unit>
+    size_t utf8_size_(const Unit* p, size_t n)
+    {
+        size_t res = 0u;
+        for(size_t i = 0u; i < n; )
+        {
+            uint32_t c = next_point_(p, n, i);
+            if(c == 0xffffffffu)
+                return simd::npos;
+
+            res += 1u + (c >= 0x80u) + (c >= 0x800u) + (c >= 0x10000u);
+        }
+
+        return res;
+    }
+
+    template<typename Unit>
+    unsigned char* encode_utf8_(const Unit* p, size_t n, unsigned char* out)
+    {
+        for(size_t i = 0u; i < n; )
+        {
+            uint32_t c = next_point_(p, n, i);
+            if(c < 0x80u)
+            {
+                *out++ = static_cast<unsigned char>(c);
+            }
+            else if(c < 0x800u)
+            {
+                *out++ = static_cast<unsigned char>(0xc0u | (c >> 6));
+                *out++ = static_cast<unsigned char>(0x80u | (c & 0x3fu));
+            }
+            else if(c < 0x10000u)
+            {
+                *out++ = static_cast<unsigned char>(0xe0u | (c >> 12));
+                *out++ = static_cast<unsigned char>(0x80u | ((c >> 6) & 0x3fu));
+                *out++ = static_cast<unsigned char>(0x80u | (c & 0x3fu));
+            }
+            else
+            {
+                *out++ = static_cast<unsigned char>(0xf0u | (c >> 18));
+                *out++ = static_cast<unsigned char>(0x80u | ((c >> 12) & 0x3fu));
+                *out++ = static_cast<unsigned char>(0x80u | ((c >> 6) & 0x3fu));
+                *out++ = static_cast<unsigned char>(0x80u | (c & 0x3fu));
+            }
+        }
+
+        return out;
+    }
+
+    template<typename Unit>
+    BasicString<Unit> from_utf8_(StringView str)
+    {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(str.data());
+        if(!validate_utf8(p, str.size()))
+            throw std::range_error{"invalid UTF-8"};
+
+        size_t points = 0u;
+        size_t quads = 0u;
+        count_utf8(p, str.size(), points, quads);
+
+        // the code points of 4 bytes take two units of UTF-16
+        size_t units = sizeof(Unit) == 2u ? points + quads : points;
+
+        BasicString<Unit> res;
+        res.resize_and_overwrite(units, [p, &str](Unit* out, size_t count)
+        {
+            Unit* end = decode_utf8_(p, str.size(), out);
+            assert(static_cast<size_t>(end - out) == count);
+            (void)end;
+
+            return count;
+        });
+
+        return res;
+    }
+
+    template<typename Unit>
+    String to_utf8_(BasicStringView<Unit> str)
+    {
+        size_t bytes = utf8_size_(str.data(), str.size());
+        if(bytes == simd::npos)
+            throw std::range_error{sizeof(Unit) == 2u ? "invalid UTF-16" : "invalid UTF-32"};
+
+        String res;
+        res.resize_and_overwrite(bytes, [&str](char* out, size_t count)
+        {
+            encode_utf8_(str.data(), str.size(), reinterpret_cast<unsigned char*>(out));
+            return count;
+        });
+
+        return res;
+    }
+}
+
+// whether str is well-formed UTF-8
+inline bool validate_utf8(StringView str)
+{
+    return utf::validate_utf8(reinterpret_cast<const unsigned char*>(str.data()), str.size());
+}
+
+// the number of code points of str, which must be valid UTF-8
+inline size_t utf8_length(StringView str)
+{
+    size_t points = 0u;
+    size_t quads = 0u;
+    utf::count_utf8(reinterpret_cast<const unsigned char*>(str.data()), str.size(), points, quads);
+
+    return points;
+}
+
+inline BasicString<char16_t> utf8_to_utf16(StringView str)
+{
+    return utf::from_utf8_<char16_t>(str);
+}
+
+inline BasicString<char32_t> utf8_to_utf32(StringView str)
+{
+    return utf::from_utf8_<char32_t>(str);
+}
+
+inline wString utf8_to_wstring(StringView str)
+{
+    return utf::from_utf8_<wchar_t>(str);
+}
+
+inline String utf16_to_utf8(BasicStringView<char16_t> str)
+{
+    return utf::to_utf8_(str);
+}
+
+inline String utf32_to_utf8(BasicStringView<char32_t> str)
+{
+    return utf::to_utf8_(str);
+}
+
+inline String wstring_to_utf8(wStringView str)
+{
+    return utf::to_utf8_(str);
+}
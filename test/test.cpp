@@ -1,8 +1,140 @@
 #include "BasicString.hpp"
-
+#include "SharedBasicString.hpp"
+#include "BasicRope.hpp"
+#include "BasicMultiSearcher.hpp"
+#include "BasicStreamSearcher.hpp"
+#include "BasicInternPool.hpp"
+#include "HashedBasicString.hpp"
+#include "MappedString.hpp"
+#include "ParallelFind.hpp"
+#include "StringSort.hpp"
+#include "StringStats.hpp"
+#include "Utf.hpp"
+
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+template<typename T>
+struct TaggedAllocator
+{
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    explicit TaggedAllocator(int tag)
+        : tag(tag)
+    {
+    }
+
+    template<typename U>
+    TaggedAllocator(const TaggedAllocator<U>& rhs)
+        : tag(rhs.tag)
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        ++live;
+        return std::allocator<T>{}.allocate(n);
+    }
+
+    void deallocate(T* p, size_t n)
+    {
+        --live;
+        std::allocator<T>{}.deallocate(p, n);
+    }
+
+    friend bool operator==(const TaggedAllocator& lhs, const TaggedAllocator& rhs)
+    {
+        return lhs.tag == rhs.tag;
+    }
+
+    friend bool operator!=(const TaggedAllocator& lhs, const TaggedAllocator& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    int tag;
+    static inline int live = 0;
+};
+
+struct StatsTag {};
+using CountedString = BasicString<char, std::char_traits<char>, std::allocator<char>, StringStats<StatsTag>>;
+
+struct CaseInsensitiveTraits : std::char_traits<char>
+{
+    static char fold(char ch)
+    {
+        return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+    }
+
+    static bool eq(char a, char b)
+    {
+        return fold(a) == fold(b);
+    }
+
+    static bool lt(char a, char b)
+    {
+        return fold(a) < fold(b);
+    }
+
+    static int compare(const char* a, const char* b, size_t n)
+    {
+        for(size_t i = 0u; i < n; ++i)
+        {
+            if(lt(a[i], b[i])) return -1;
+            if(lt(b[i], a[i])) return 1;
+        }
+        return 0;
+    }
+
+    static const char* find(const char* p, size_t n, char ch)
+    {
+        for(size_t i = 0u; i < n; ++i)
+        {
+            if(eq(p[i], ch)) return p + i;
+        }
+        return nullptr;
+    }
+};
+
+// a stream buffer that gives the chars of text, and then throws; and throws on any write
+struct ThrowingStreamBuf : std::streambuf
+{
+    explicit ThrowingStreamBuf(const char* text)
+        : text(text)
+    {
+    }
+
+    int_type underflow() override
+    {
+        if(*text == '\0')
+            throw std::runtime_error{"read error"};
+
+        ch = *text++;
+        setg(&ch, &ch, &ch + 1);
+        return traits_type::to_int_type(ch);
+    }
+
+    int_type overflow(int_type) override
+    {
+        throw std::runtime_error{"write error"};
+    }
+
+    const char* text;
+    char ch = '\0';
+};
 
 int main()
 {
@@ -103,6 +235,19 @@ int main()
         assert( oss.str() == "[Hello]" );
     }
 
+    // reserve on an empty string, npos odr-used
+    {
+        BasicString<char> str;
+        str.reserve(100u);
+
+        assert( str.capacity() >= 100u );
+        assert( str.size() == 0u );
+        assert( str.c_str()[0] == '\0' );
+
+        const size_t& npos = BasicString<char>::npos;
+        assert( npos == size_t(-1) );
+    }
+
     // copy assign
     {
         BasicString<char> str0{"Hello New Copy World!"};
@@ -193,57 +338,87 @@ int main()
         assert( oss.str() == "[New World! Where no man has gone before!]" );
     }
 
+    // assign - from a part of itself
+    {
+        BasicString<char> str{"0123456789abcdefghijklmnopqrstuv"};
+        str.assign(str.data() + 2, 10u);
+
+        assert( str.size() == 10u );
+        assert( str == "23456789ab" );
+        assert( str.c_str()[10] == '\0' );
+    }
+
+    // append - from a part of itself, growing
+    {
+        BasicString<char> str{"0123456789abcdefghijklmnopqrstuv"};
+        str.shrink_to_fit();
+        str.append(str.data(), str.size());
+        assert( str == "0123456789abcdefghijklmnopqrstuv0123456789abcdefghijklmnopqrstuv" );
+
+        str.append(str);
+        assert( str.size() == 128u && str.substr_view(96u) == "0123456789abcdefghijklmnopqrstuv" );
+
+        str.append(str.substr_view(10u, 6u));
+        assert( str.size() == 134u && str.substr_view(128u) == "abcdef" );
+
+        BasicString<char> shrt{"short"}; // inline
+        shrt.append(shrt);
+        shrt.append(shrt);
+        shrt.append(shrt);
+        assert( shrt == "shortshortshortshortshortshortshortshort" );
+    }
+
     // append (multiple), push_back
     {
         size_t oldCap = 0u;
-        BasicString<char> str = "hello";
+        BasicString<char> str = "hello hello hello";
 
-        assert( str.size() == 5u );
+        assert( str.size() == 17u );
         assert( str.capacity() >= str.size() );
         assert( str.data() != nullptr );
         assert( str.empty() == false );
 
         std::ostringstream oss;
         oss << "[" << str << "]";
-        assert( oss.str() == "[hello]" );
+        assert( oss.str() == "[hello hello hello]" );
 
         {
             oldCap = str.capacity();
 
             str.append(" ");
-            assert( str.size() == 6u );
+            assert( str.size() == 18u );
             assert( str.capacity() >= str.size() );
             assert( str.capacity() > oldCap );
 
             std::ostringstream oss;
             oss << "[" << str << "]";
-            assert( oss.str() == "[hello ]" );
+            assert( oss.str() == "[hello hello hello ]" );
         }
 
         {
             oldCap = str.capacity();
 
             str.append("wor");
-            assert( str.size() == 9u );
+            assert( str.size() == 21u );
             assert( str.capacity() >= str.size() );
             assert( str.capacity() == oldCap );
 
             std::ostringstream oss;
             oss << "[" << str << "]";
-            assert( oss.str() == "[hello wor]" );
+            assert( oss.str() == "[hello hello hello wor]" );
         }
 
         {
             oldCap = str.capacity();
 
-            str.append("ld");
-            assert( str.size() == 11u );
+            str.append("ld, good night!");
+            assert( str.size() == 36u );
             assert( str.capacity() >= str.size() );
             assert( str.capacity() > oldCap );
 
             std::ostringstream oss;
             oss << "[" << str << "]";
-            assert( oss.str() == "[hello world]" );
+            assert( oss.str() == "[hello hello hello world, good night!]" );
         }
     }
 
@@ -271,20 +446,302 @@ int main()
 
         size_t oldCap = str.capacity();
 
-        str = "Hello";
+        str = "Hello, Hello, Hello!";
 
-        assert( str.size() == 5u );
+        assert( str.size() == 20u );
         assert( str.capacity() > str.size() );
         assert( str.capacity() == oldCap );
 
         str.shrink_to_fit();
-        assert( str.size() == 5u );
+        assert( str.size() == 20u );
         assert( str.capacity() == str.size() );
         assert( str.capacity() < oldCap );
 
         std::ostringstream oss;
         oss << "[" << str << "]";
-        assert( oss.str() == "[Hello]" );
+        assert( oss.str() == "[Hello, Hello, Hello!]" );
+    }
+
+    // small string - stored inline
+    {
+        auto is_inline = [](const BasicString<char>& str)
+        {
+            auto* p = reinterpret_cast<const char*>(str.data());
+            auto* b = reinterpret_cast<const char*>(&str);
+            return p >= b && p < b + sizeof(str);
+        };
+
+        static_assert( sizeof(BasicString<char>) == 3 * sizeof(void*) );
+
+        BasicString<char> str{"Hello"};
+        assert( is_inline(str) );
+        assert( str.capacity() >= str.size() );
+
+        BasicString<char> empty;
+        assert( is_inline(empty) );
+        assert( *empty.c_str() == '\0' );
+
+        // grows out to the heap
+        str.append(" World! This will not fit inline.");
+        assert( !is_inline(str) );
+
+        // and shrinks back in
+        str.erase(5u);
+        str.shrink_to_fit();
+        assert( is_inline(str) );
+        assert( str.size() == 5u );
+
+        {
+            std::ostringstream oss;
+            oss << "[" << str << "]";
+            assert( oss.str() == "[Hello]" );
+        }
+
+        // move leaves source empty
+        BasicString<char> str2 = std::move(str);
+        assert( is_inline(str2) );
+        assert( str.size() == 0u );
+        assert( *str.c_str() == '\0' );
+
+        // swap inline with heap
+        BasicString<char> big{"Something big!Something big!Something big!"};
+        swap(str2, big);
+        assert( is_inline(big) );
+        assert( !is_inline(str2) );
+
+        {
+            std::ostringstream oss;
+            oss << "[" << big << "][" << str2 << "]";
+            assert( oss.str() == "[Hello][Something big!Something big!Something big!]" );
+        }
+    }
+
+    // allocator - propagation
+    {
+        using TString = BasicString<char, std::char_traits<char>, TaggedAllocator<char>>;
+
+        {
+            TString str1{"Something big!Something big!Something big!", TaggedAllocator<char>{1}};
+            TString str2{"Something else, also big!", TaggedAllocator<char>{2}};
+            assert( TaggedAllocator<char>::live == 2 );
+
+            TString str3 = str1; // copy construct
+            assert( str3.get_allocator().tag == 1 );
+
+            str3 = str2; // copy assign - propagates
+            assert( str3.get_allocator().tag == 2 );
+
+            str3 = std::move(str1); // move assign - propagates
+            assert( str3.get_allocator().tag == 1 );
+
+            swap(str2, str3); // swap - propagates
+            assert( str2.get_allocator().tag == 1 );
+            assert( str3.get_allocator().tag == 2 );
+
+            std::ostringstream oss;
+            oss << "[" << str2 << "][" << str3 << "]";
+            assert( oss.str() == "[Something big!Something big!Something big!][Something else, also big!]" );
+        }
+
+        assert( TaggedAllocator<char>::live == 0 );
+    }
+
+    // allocator - polymorphic
+    {
+        char buffer[256];
+        std::pmr::monotonic_buffer_resource pool{buffer, sizeof(buffer), std::pmr::null_memory_resource()};
+
+        auto in_pool = [&](const pmr::String& str)
+        {
+            return str.data() >= buffer && str.data() < buffer + sizeof(buffer);
+        };
+
+        pmr::String str{"Something big!Something big!Something big!", &pool};
+        assert( in_pool(str) );
+
+        pmr::String other{"Something else, also big!"}; // default resource
+        assert( !in_pool(other) );
+
+        str = std::move(other); // resources differ - copies into the pool
+        assert( in_pool(str) );
+
+        str.append(" And then some.");
+        assert( in_pool(str) );
+
+        std::ostringstream oss;
+        oss << "[" << str << "]";
+        assert( oss.str() == "[Something else, also big! And then some.]" );
+    }
+
+    // resize
+    {
+        BasicString<char> str{"Hello"};
+
+        str.resize(8u, '!');
+        assert( str.size() == 8u );
+
+        {
+            std::ostringstream oss;
+            oss << "[" << str << "]";
+            assert( oss.str() == "[Hello!!!]" );
+        }
+
+        str.resize(4u);
+        assert( str.size() == 4u );
+        assert( str.c_str()[4] == '\0' );
+
+        {
+            std::ostringstream oss;
+            oss << "[" << str << "]";
+            assert( oss.str() == "[Hell]" );
+        }
+    }
+
+    // resize_and_overwrite
+    {
+        BasicString<char> str{"Value: "};
+
+        str.resize_and_overwrite(64u, [](char* p, size_t n)
+        {
+            assert( n == 64u );
+            assert( std::memcmp(p, "Value: ", 7u) == 0 ); // existing contents kept
+
+            std::memcpy(p + 7, "forty-two", 9u);
+            return 16u;
+        });
+
+        assert( str.size() == 16u );
+        assert( str.capacity() >= 64u );
+        assert( str.c_str()[16] == '\0' );
+
+        std::ostringstream oss;
+        oss << "[" << str << "]";
+        assert( oss.str() == "[Value: forty-two]" );
+    }
+
+    // append_uninitialized
+    {
+        BasicString<char> str{"Header|"};
+        std::string payload = "a payload that was read off the wire";
+
+        // read into the string, then give back what was not used
+        auto s = str.append_uninitialized(100u);
+        assert( s.size() == 100u );
+        assert( str.size() == 107u );
+
+        std::memcpy(s.data(), payload.data(), payload.size());
+        str.resize(str.size() - (s.size() - payload.size()));
+
+        assert( str.size() == 7u + payload.size() );
+
+        std::ostringstream oss;
+        oss << "[" << str << "]";
+        assert( oss.str() == "[Header|a payload that was read off the wire]" );
+    }
+
+    // operator+ - lazy, one allocation
+    {
+        using TString = BasicString<char, std::char_traits<char>, TaggedAllocator<char>>;
+
+        BasicString<char> a{"Something big! "};
+        BasicString<char> b{"Something else! "};
+        BasicString<char> c{"And more."};
+
+        auto expr = a + b + "Literal " + '#' + c;
+        assert( expr.size() == 49u );
+
+        BasicString<char> str = expr;
+        assert( str.size() == 49u );
+        assert( str.capacity() == str.size() );
+
+        {
+            std::ostringstream oss;
+            oss << "[" << str << "]";
+            assert( oss.str() == "[Something big! Something else! Literal #And more.]" );
+        }
+
+        {
+            BasicString<char> str2 = "<" + (a + c) + ">" + (c + a);
+            std::ostringstream oss;
+            oss << "[" << str2 << "]";
+            assert( oss.str() == "[<Something big! And more.>And more.Something big! ]" );
+        }
+
+        // only the materialized result allocates
+        TString x{"Something big!Something big!", TaggedAllocator<char>{1}};
+        TString y{"Something else, also big!", TaggedAllocator<char>{1}};
+        assert( TaggedAllocator<char>::live == 2 );
+
+        auto e = x + " " + y + " " + x + " " + y;
+        assert( TaggedAllocator<char>::live == 2 );
+
+        {
+            TString z{e.str()};
+            assert( TaggedAllocator<char>::live == 3 );
+        }
+    }
+
+    // operator+ - rvalue operands reuse their buffer
+    {
+        BasicString<char> a{"Something big! "};
+        BasicString<char> c{"And more."};
+
+        BasicString<char> tmp{"Something else! "};
+        tmp.reserve(100u);
+        const char* buf = tmp.data();
+
+        BasicString<char> str = std::move(tmp) + a + "Literal " + c;
+        assert( str.data() == buf );
+
+        {
+            std::ostringstream oss;
+            oss << "[" << str << "]";
+            assert( oss.str() == "[Something else! Something big! Literal And more.]" );
+        }
+
+        BasicString<char> tmp2{"the end."};
+        tmp2.reserve(100u);
+        buf = tmp2.data();
+
+        BasicString<char> str2 = a + c + ' ' + std::move(tmp2);
+        assert( str2.data() == buf );
+
+        {
+            std::ostringstream oss;
+            oss << "[" << str2 << "]";
+            assert( oss.str() == "[Something big! And more. the end.]" );
+        }
+    }
+
+    // operator+ - rvalue operand with pieces of itself
+    {
+        const char* text = "0123456789abcdefghijklmnopqrstuv";
+
+        BasicString<char> s{text};
+        BasicString<char> r = std::move(s) + s;
+        assert( r == BasicString<char>{"0123456789abcdefghijklmnopqrstuv0123456789abcdefghijklmnopqrstuv"} );
+
+        BasicString<char> s2{text};
+        BasicString<char> r2 = std::move(s2) + s2 + "x";
+        assert( r2 == BasicString<char>{"0123456789abcdefghijklmnopqrstuv0123456789abcdefghijklmnopqrstuvx"} );
+
+        BasicString<char> s3{text};
+        BasicString<char> r3 = std::move(s3) + s3.c_str();
+        assert( r3.size() == 64u );
+        assert( r3.substr_view(32u) == text );
+
+        // room to spare: still in place
+        BasicString<char> s4{text};
+        s4.reserve(100u);
+        const char* buf = s4.data();
+        BasicString<char> r4 = std::move(s4) + s4;
+        assert( r4.data() == buf );
+        assert( r4 == r );
+
+        BasicString<char> s5{text};
+        s5.reserve(100u);
+        BasicString<char> r5 = s5 + std::move(s5);
+        assert( r5 == r );
     }
 
     // substr
@@ -400,6 +857,22 @@ int main()
         assert( oss.str() == "[This is a multi-faceted world!]" );
     }
 
+    // replace - with a part of itself
+    {
+        BasicString<char> str{"0123456789abcdefghijklmnopqrstuv"};
+        str.replace(0u, 10u, str.data() + 2, 10u); // same size, overlapping
+        assert( str == "23456789ababcdefghijklmnopqrstuv" );
+
+        BasicString<char> str2{"0123456789abcdefghijklmnopqrstuv"};
+        str2.reserve(100u);
+        str2.replace(0u, 2u, str2.data() + 20u, 4u); // grows, the tail moves
+        assert( str2 == "klmn23456789abcdefghijklmnopqrstuv" );
+
+        BasicString<char> str3{"0123456789abcdefghijklmnopqrstuv"};
+        str3.replace(20u, 10u, str3.data(), 4u); // shrinks
+        assert( str3 == "0123456789abcdefghij0123uv" );
+    }
+
     // erase
     {
         BasicString<char> str{"This is a very good world!"};
@@ -564,5 +1037,1265 @@ int main()
         }
     }
 
+    // find - long haystack (vectorized paths), against std::string
+    {
+        std::string ref;
+        for(unsigned i = 0u; i < 3000u; ++i)
+            ref += static_cast<char>('a' + (i * 7u + i / 13u) % 3u);
+        ref += "needle";
+
+        BasicString<char> str{ref.data(), ref.size()};
+
+        const char* needles[] = { "needle", "abc", "aab", "cba", "ccc", "a", "abcabcab", "bacbacbacbacbacbacbacbacbacbacbacb", "x" };
+        for(const char* needle : needles)
+        {
+            for(size_t index : { 0u, 1u, 17u, 31u, 32u, 33u, 1000u, 2990u, 3005u })
+            {
+                size_t expected = ref.find(needle, index);
+                size_t n = std::strlen(needle);
+
+                assert( str.find(needle, index) == (expected == std::string::npos ? str.npos : expected) );
+
+                size_t r = simd::find_scalar(ref.data() + index, ref.size() - index, needle, n);
+                assert( r == (expected == std::string::npos ? simd::npos : expected - index) );
+
+#if BASIC_STRING_SIMD_X86
+                r = simd::find_sse2(ref.data() + index, ref.size() - index, needle, n);
+                assert( r == (expected == std::string::npos ? simd::npos : expected - index) );
+
+                if(simd::has_avx2())
+                {
+                    r = simd::find_avx2(ref.data() + index, ref.size() - index, needle, n);
+                    assert( r == (expected == std::string::npos ? simd::npos : expected - index) );
+                }
+#endif
+            }
+        }
+    }
+
+    // searcher - against std::string, short and long needles
+    {
+        std::string ref;
+        for(unsigned i = 0u; i < 5000u; ++i)
+            ref += static_cast<char>('a' + (i * i + i / 7u) % 3u);
+
+        BasicString<char> str{ref.data(), ref.size()};
+
+        std::string needles[] = {
+            "a", "ab", "ba", "aa", "abc", "aaa", "abab", "cacbca",
+            ref.substr(100, 31), ref.substr(100, 32), ref.substr(4000, 250),
+            std::string(40, 'a'), std::string(40, 'a') + "b", "b" + std::string(40, 'a'),
+            ref.substr(4990) + "x",
+        };
+
+        for(const std::string& needle : needles)
+        {
+            BasicString<char>::searcher s{needle.data(), needle.size()};
+
+            for(size_t index : { 0u, 1u, 99u, 100u, 101u, 3999u, 4000u, 4001u, 4990u, 5000u })
+            {
+                size_t expected = ref.find(needle, index);
+                assert( str.find(s, index) == (expected == std::string::npos ? str.npos : expected) );
+            }
+        }
+    }
+
+    // searcher - adversarial input, reused across haystacks
+    {
+        BasicString<char> hay1{std::string(100000u, 'a').c_str()};
+        BasicString<char> hay2 = hay1;
+        hay2.append("b");
+
+        BasicString<char> needle{std::string(1000u, 'a').c_str()};
+        needle.append("b");
+
+        BasicString<char>::searcher s{needle};
+        assert( hay1.find(s) == hay1.npos );
+        assert( hay2.find(s) == hay2.size() - needle.size() );
+    }
+
+    // searcher - wide chars (no skip table)
+    {
+        wString str{L"abracadabra, abracadabra!"};
+        wString::searcher s{L"cadabra!", 8u};
+
+        assert( str.find(s) == 17u );
+        assert( str.find(s, 18u) == str.npos );
+    }
+
+    // traits - find goes through Traits
+    {
+        BasicString<char, CaseInsensitiveTraits> str{"Hello World, hello WORLD!"};
+
+        assert( str.find("WORLD") == 6u );
+        assert( str.find("world", 7u) == 19u );
+        assert( str.find("planet") == str.npos );
+
+        BasicString<char, CaseInsensitiveTraits>::searcher s{"HELLO", 5u};
+        assert( str.find(s, 1u) == 13u );
+    }
+
+    // traits - wide chars
+    {
+        wString str{L"This is a very good world!"};
+        str.shrink_to_fit();
+
+        str.replace(10u, 4u, L"rather");
+        assert( str.size() == 28u );
+        assert( str.find(L"good") == 17u );
+
+        str.erase(10u, 7u);
+        assert( str.size() == 21u );
+        assert( str.find(L"a good world!") == 8u );
+        assert( str.c_str()[21] == L'\0' );
+    }
+
+    // shared string - O(1) copies
+    {
+        SharedString str{"Something big!Something big!Something big!"};
+        assert( str.use_count() == 1u );
+        assert( str.size() == 42u );
+
+        {
+            SharedString str2 = str;
+            assert( str.use_count() == 2u );
+            assert( str2.data() == str.data() );
+        }
+
+        assert( str.use_count() == 1u );
+        assert( str.find("big!", 11u) == 24u );
+        assert( std::strcmp(str.c_str(), "Something big!Something big!Something big!") == 0 );
+
+        BasicString<char> sub = str.substr(14u, 9u);
+        std::ostringstream oss;
+        oss << "[" << sub << "]";
+        assert( oss.str() == "[Something]" );
+
+        SharedString empty;
+        assert( empty.size() == 0u );
+        assert( *empty.c_str() == '\0' );
+        assert( empty.use_count() == 0u );
+
+        assert( std::min(size_t(3u), empty.npos) == 3u ); // odr-used
+    }
+
+    // shared string - buffer hand-over to and from BasicString
+    {
+        BasicString<char> str{"Something big!Something big!Something big!"};
+        str.reserve(100u);
+        const char* buf = str.data();
+
+        SharedString shared{std::move(str)}; // room for the count - taken over
+        assert( shared.data() == buf );
+        assert( str.size() == 0u );
+
+        SharedString copy = shared;
+        BasicString<char> str2 = static_cast<BasicString<char>>(std::move(copy)); // shared - copied
+        assert( str2.data() != buf );
+        assert( shared.use_count() == 1u );
+
+        BasicString<char> str3 = static_cast<BasicString<char>>(std::move(shared)); // unique - handed over
+        assert( str3.data() == buf );
+        assert( str3.capacity() >= 100u );
+        assert( shared.use_count() == 0u );
+
+        str3.append(" And then some.");
+        assert( str3.data() == buf );
+
+        std::ostringstream oss;
+        oss << "[" << str2 << "][" << str3 << "]";
+        assert( oss.str() == "[Something big!Something big!Something big!]"
+                             "[Something big!Something big!Something big! And then some.]" );
+
+        BasicString<char> tight{"Something big!Something big!Something big!"};
+        tight.shrink_to_fit();
+        buf = tight.data();
+
+        SharedString shared2{std::move(tight)}; // no room for the count - copied
+        assert( shared2.data() != buf );
+        assert( std::strcmp(shared2.c_str(), "Something big!Something big!Something big!") == 0 );
+
+        BasicString<char> built;
+        built.reserve(42u + SharedString::control_room()); // room for the count, from the start
+        built.append("Something big!Something big!Something big!");
+        buf = built.data();
+
+        SharedString shared3{std::move(built)};
+        assert( shared3.data() == buf );
+        assert( shared3 == shared2 );
+    }
+
+    // shared string - comparisons
+    {
+        SharedString abc{"abc"};
+        SharedString abd{"abd"};
+        BasicString<char> str{"abc"};
+
+        assert( abc == "abc" && "abc" == abc && abc != "ab" && "abd" != abc );
+        assert( abc == StringView{"abc"} && StringView{"abc"} == abc );
+        assert( abc == str && str == abc && abd != str );
+        assert( abc == SharedString{abc} && abc != abd );
+        assert( abc < abd && abc <= abd && abd > abc && abd >= abc );
+        assert( abc < "abd" && "abb" < abc && abc <= "abc" && abc >= "abc" && abc > "ab" && "b" > abc );
+        assert( SharedString{} == "" && SharedString{} < abc );
+    }
+
+    // shared string - across threads, with a stateful allocator
+    {
+        using TShared = SharedBasicString<char, std::char_traits<char>, TaggedAllocator<char>>;
+
+        {
+            TShared str{"Something big!Something big!Something big!", TaggedAllocator<char>{7}};
+            assert( TaggedAllocator<char>::live == 1 );
+            assert( str.get_allocator().tag == 7 );
+
+            std::vector<std::thread> threads;
+            for(int t = 0; t < 4; ++t)
+            {
+                threads.emplace_back([str]
+                {
+                    for(int i = 0; i < 1000; ++i)
+                    {
+                        TShared copy = str;
+                        assert( copy.size() == 42u );
+                    }
+                });
+            }
+
+            for(std::thread& t : threads)
+                t.join();
+
+            assert( str.use_count() == 1u );
+        }
+
+        assert( TaggedAllocator<char>::live == 0 );
+    }
+
+    // rope - insert, erase, substr
+    {
+        Rope rope{"This is a world!"};
+
+        rope.insert(10u, "very good ");
+        rope.append(" That is true!");
+        assert( rope.size() == 40u );
+        assert( rope[10] == 'v' );
+
+        {
+            std::ostringstream oss;
+            oss << "[" << rope << "]";
+            assert( oss.str() == "[This is a very good world! That is true!]" );
+        }
+
+        Rope sub = rope.substr(10u, 15u);
+        rope.erase(10u, 5u);
+
+        {
+            std::ostringstream oss;
+            oss << "[" << rope << "][" << sub << "]";
+            assert( oss.str() == "[This is a good world! That is true!][very good world]" );
+        }
+
+        BasicString<char> flat = rope.str();
+        assert( flat.size() == 35u );
+        assert( flat.find("true!") == 30u );
+
+        const size_t& npos = Rope::npos; // odr-used
+        assert( npos == size_t(-1) );
+    }
+
+    // rope - large document edits, against std::string
+    {
+        std::string ref;
+        Rope rope;
+
+        unsigned seed = 1u;
+        auto next = [&seed]() { seed = seed * 1103515245u + 12345u; return seed >> 8; };
+
+        for(int i = 0; i < 500; ++i)
+        {
+            size_t index = next() % (ref.size() + 1);
+            if(next() % 3u != 0u)
+            {
+                std::string text(next() % 700u, static_cast<char>('a' + next() % 26u));
+                rope.insert(index, text.data(), text.size());
+                ref.insert(index, text);
+            }
+            else
+            {
+                size_t count = next() % 900u;
+                rope.erase(index, count);
+                ref.erase(index, count);
+            }
+
+            assert( rope.size() == ref.size() );
+        }
+
+        size_t chunks = 0u;
+        std::string out;
+        rope.for_each_chunk([&](const char* chunk, size_t sz)
+        {
+            ++chunks;
+            out.append(chunk, sz);
+        });
+
+        assert( out == ref );
+        assert( chunks > 1u );
+
+        BasicString<char> flat = rope.str();
+        assert( std::string(flat.data(), flat.size()) == ref );
+    }
+
+    // instrumentation - counted allocations, growths and copies, per thread
+    {
+        using Stats = StringStats<StatsTag>;
+        Stats::reset();
+
+        {
+            CountedString s{"short"};   // local buffer, no allocation
+            assert( Stats::snapshot().allocations == 0u );
+            assert( Stats::snapshot().bytes_copied == 5u );
+
+            s.append(" and then a longer tail", 23u); // grows, copying the 5 over
+            StringStatsSnapshot st = Stats::snapshot();
+            assert( st.allocations == 1u );
+            assert( st.growths == 1u );
+            assert( st.deallocations == 0u );
+            assert( st.bytes_copied == 5u + 5u + 23u );
+            assert( st.peak_capacity == s.capacity() + 1u );
+        }
+
+        assert( Stats::snapshot().deallocations == 1u );
+
+        std::thread t{[]
+        {
+            CountedString s(std::string(100u, 'x').c_str()); // grows from empty
+            s.reserve(1000u);
+        }};
+        t.join();
+
+        StringStatsSnapshot st = Stats::snapshot(); // includes the exited thread
+        assert( st.allocations == 3u );
+        assert( st.deallocations == 3u );
+        assert( st.growths == 3u );
+        assert( st.peak_capacity == 1001u );
+
+        // the default policy does not count
+        String plain{"not counted, as it is not instrumented"};
+        assert( Stats::snapshot().allocations == 3u );
+    }
+
+    // growth policies
+    {
+        using Halves = BasicString<char, std::char_traits<char>, std::allocator<char>, NoStringStats, HalfAgainGrowth>;
+        using Classes = BasicString<char, std::char_traits<char>, std::allocator<char>, NoStringStats, SizeClassGrowth<>>;
+        using wClasses = BasicString<wchar_t, std::char_traits<wchar_t>, std::allocator<wchar_t>, NoStringStats, SizeClassGrowth<>>;
+
+        const std::string text(300000u, 'x');
+
+        String s;
+        s.append(text.data(), 40u);
+        s.append(text.data(), 1u);
+        assert( s.capacity() == 80u );
+
+        Halves h;
+        h.append(text.data(), 40u);
+        h.append(text.data(), 1u);
+        assert( h.capacity() == 60u );
+
+        Classes c;
+        c.append(text.data(), 20u);
+        assert( c.capacity() == 31u );   // 21 bytes, in a class of 32
+        c.append(text.data(), 12u);
+        assert( c.capacity() == 47u );   // doubled to 40, 41 bytes in a class of 48
+        c.append(text.data(), 100u);
+        assert( c.capacity() == 159u );  // 133 bytes, in a class of 160
+        c.append(text.data(), text.size() - c.size());
+        assert( c.capacity() == 303103u ); // to whole pages: 74 * 4096 - 1
+        assert( c.size() == text.size() );
+        assert( std::string(c.data(), c.size()) == text );
+
+        wClasses w;
+        w.append(L"abcd", 4u);
+        assert( w.capacity() == 7u );    // 5 elements of 4 bytes, in a class of 32
+        assert( std::wstring(w.data(), w.size()) == L"abcd" );
+    }
+
+    // string views - constexpr, and interop with BasicString and std::string_view
+    {
+        constexpr StringView cv{"hello, world"};
+        static_assert( cv.size() == 12u );
+        static_assert( cv.find("world") == 7u );
+        static_assert( cv.find('o', 5u) == 8u );
+        static_assert( cv.substr(7u, 3u) == "wor" );
+        static_assert( cv.substr(0u, 5u).compare("help") < 0 );
+        static_assert( cv.find("xyz") == StringView::npos );
+
+        String s{"The quick brown fox jumps over the lazy dog"};
+        StringView v = s;
+        assert( v.size() == s.size() && v.data() == s.data() );
+
+        StringView fox = s.substr_view(16u, 3u);
+        assert( fox == "fox" && fox.data() == s.data() + 16 );
+        assert( s.find(fox) == 16u );
+
+        std::string_view sv = "jumps";
+        assert( s.find(sv) == 20u );
+        assert( std::string_view(fox) == "fox" );
+
+        String t{sv};
+        assert( t.size() == 5u && std::strcmp(t.c_str(), "jumps") == 0 );
+
+        t.append(StringView{" over"});
+        t.insert(0u, std::string_view{"it "});
+        t.replace(3u, 5u, s.substr_view(10u, 5u));
+        assert( std::strcmp(t.c_str(), "it brown over") == 0 );
+
+        t = std::string_view{"assigned from a view, too long for the local buffer"};
+        assert( t.size() == 51u && t.find(StringView{"view"}) == 16u );
+
+        // other string types (allocators) convert through views too
+        pmr::String p{"pmr"};
+        t.assign(StringView{p});
+        t.append(p);
+        assert( std::strcmp(t.c_str(), "pmrpmr") == 0 );
+
+        SharedString shared{"shared text"};
+        StringView shv = shared;
+        assert( shv == "shared text" && shared.find(StringView{"text"}) == 7u );
+
+        std::ostringstream oss;
+        oss << "[" << fox << "]";
+        assert( oss.str() == "[fox]" );
+    }
+
+    // split - lazy fields as views, and split_into
+    {
+        String csv{"name,age,,city\nalice,30,x,paris\n"};
+
+        std::vector<std::string> fields;
+        for(StringView f : csv.split(",\n"))
+            fields.emplace_back(f.data(), f.size());
+
+        const char* expected[] = { "name", "age", "", "city", "alice", "30", "x", "paris", "" };
+        assert( fields.size() == 9u );
+        for(size_t i = 0u; i < fields.size(); ++i)
+            assert( fields[i] == expected[i] );
+
+        auto lines = csv.split("\n");
+        assert( lines.count() == 3u );
+        assert( *lines.begin() == "name,age,,city" );
+        assert( lines.begin()->data() == csv.data() ); // no copies
+
+        std::vector<StringView> out;
+        csv.substr_view(0u, 14u).split_into(out, ",");
+        assert( out.size() == 4u && out[3] == "city" && out[2].empty() );
+
+        assert( StringView{}.split(",").count() == 0u );
+        assert( StringView{"no delimiters"}.split(",").count() == 1u );
+        assert( StringView{"a,b"}.split("").count() == 1u );
+
+        std::vector<String> owned;
+        StringView{"x y"}.split_into(owned, " ");
+        assert( owned.size() == 2u && std::strcmp(owned[1].c_str(), "y") == 0 );
+
+        wString wide{L"a;b;;c"};
+        std::vector<std::wstring> wfields;
+        for(wStringView f : wide.split(L";"))
+            wfields.emplace_back(f.data(), f.size());
+        assert( (wfields == std::vector<std::wstring>{ L"a", L"b", L"", L"c" }) );
+    }
+
+    // split - delimiter scan (vectorized paths), against std::string
+    {
+        std::string ref;
+        for(unsigned i = 0u; i < 2000u; ++i)
+            ref += static_cast<char>('a' + (i * 7u + i / 11u) % 20u);
+        ref[1500] = ';';
+        ref[1999] = '|';
+
+        const char* sets[] = { ";", "|", "|;", "xyz;", "qrst", "ABCDEFGH;", "ABCDEFGHI|", "" };
+        for(const char* set : sets)
+        {
+            for(size_t index : { 0u, 1u, 31u, 33u, 1500u, 1501u, 1990u })
+            {
+                size_t expected = ref.find_first_of(set, index);
+                expected = expected == std::string::npos ? simd::npos : expected - index;
+
+                const char* hay = ref.data() + index;
+                size_t n = ref.size() - index;
+                size_t k = std::strlen(set);
+
+                assert( simd::find_first_of_scalar(hay, n, set, k) == expected );
+#if BASIC_STRING_SIMD_X86
+                assert( simd::find_first_of_sse2(hay, n, set, k) == expected );
+
+                if(simd::has_avx2())
+                    assert( simd::find_first_of_avx2(hay, n, set, k) == expected );
+#endif
+            }
+        }
+    }
+
+    // multi-pattern search - all matches, overlapping ones included
+    {
+        MultiSearcher ms{ "he", "she", "his", "hers", "she" };
+        assert( ms.size() == 5u && ms.pattern(3u) == "hers" );
+
+        String text{"ushers and his"};
+        std::vector<MultiSearcher::match> found = ms.find_all(text);
+
+        // by end position, then longest first
+        std::vector<std::pair<size_t, size_t>> expected = { {4u, 1u}, {1u, 1u}, {0u, 2u}, {3u, 2u}, {2u, 11u} };
+        assert( found.size() == expected.size() );
+        for(size_t i = 0u; i < found.size(); ++i)
+        {
+            assert( found[i].pattern == expected[i].first );
+            assert( found[i].position == expected[i].second );
+        }
+
+        assert( ms.contains_any(StringView{"the"}) );
+        assert( !ms.contains_any(StringView{"xyz"}) );
+        assert( ms.find_all(StringView{}).empty() );
+
+        // chars are told apart with Traits
+        BasicMultiSearcher<char, CaseInsensitiveTraits> ci{ "Error", "WARN" };
+        assert( ci.find_all("an ERROR, a warning").size() == 2u );
+
+        wMultiSearcher wms{ L"ab", L"b" };
+        assert( wms.find_all(L"abab").size() == 4u );
+
+        bool threw = false;
+        try { MultiSearcher{ "a", "" }; } catch(const std::invalid_argument&) { threw = true; }
+        assert( threw );
+    }
+
+    // multi-pattern search - against std::string::find, per pattern
+    {
+        unsigned seed = 7u;
+        auto next = [&seed]() { seed = seed * 1103515245u + 12345u; return seed >> 8; };
+
+        std::string text;
+        for(int i = 0; i < 5000; ++i)
+            text += static_cast<char>('a' + next() % 4u);
+
+        std::vector<std::string> patterns;
+        for(int i = 0; i < 200; ++i)
+        {
+            std::string p;
+            for(unsigned n = 1u + next() % 6u; n != 0u; --n)
+                p += static_cast<char>('a' + next() % 5u);
+            patterns.push_back(p);
+        }
+
+        std::vector<StringView> views(patterns.begin(), patterns.end());
+        MultiSearcher ms{views};
+
+        std::vector<size_t> counts(patterns.size(), 0u);
+        size_t total = 0u;
+        ms.for_each_match(StringView{text.data(), text.size()}, [&](const MultiSearcher::match& m)
+        {
+            assert( text.compare(m.position, patterns[m.pattern].size(), patterns[m.pattern]) == 0 );
+            ++counts[m.pattern];
+            ++total;
+        });
+
+        size_t expected_total = 0u;
+        for(size_t p = 0u; p < patterns.size(); ++p)
+        {
+            size_t n = 0u;
+            for(size_t i = text.find(patterns[p]); i != std::string::npos; i = text.find(patterns[p], i + 1))
+                ++n;
+
+            assert( counts[p] == n );
+            expected_total += n;
+        }
+
+        assert( total == expected_total && total > 0u );
+    }
+
+    // replace_all - single pattern, growing, shrinking and in place
+    {
+        String s{"a-b-c-d"};
+        const char* p = s.data();
+
+        assert( s.replace_all("-", "+") == 3u );
+        assert( std::strcmp(s.c_str(), "a+b+c+d") == 0 && s.data() == p );
+
+        assert( s.replace_all("+", "") == 3u );
+        assert( std::strcmp(s.c_str(), "abcd") == 0 );
+
+        assert( s.replace_all("b", "<bbb>") == 1u );
+        assert( std::strcmp(s.c_str(), "a<bbb>cd") == 0 );
+
+        assert( s.replace_all("bb", "B") == 1u ); // no overlaps, left to right
+        assert( std::strcmp(s.c_str(), "a<Bb>cd") == 0 );
+
+        assert( s.replace_all("xyz", "!") == 0u && s.replace_all("", "!") == 0u );
+        assert( std::strcmp(s.c_str(), "a<Bb>cd") == 0 );
+
+        String big{"one fish, two fish, red fish, blue fish: a long enough string"};
+        big.reserve(200u);
+        p = big.data();
+        assert( big.replace_all("fish", "whale") == 4u ); // grows in place
+        assert( std::strcmp(big.c_str(), "one whale, two whale, red whale, blue whale: a long enough string") == 0 );
+        assert( big.data() == p );
+
+        // the replacement may come from the string itself
+        assert( big.replace_all("whale", big.substr_view(0u, 3u)) == 4u );
+        assert( std::strcmp(big.c_str(), "one one, two one, red one, blue one: a long enough string") == 0 );
+    }
+
+    // replace_all - several pairs at once
+    {
+        String s{"the cat sat on the mat"};
+        assert( s.replace_all({ { "cat", "dog" }, { "at", "AT" }, { "the", "a" } }) == 5u );
+        assert( std::strcmp(s.c_str(), "a dog sAT on a mAT") == 0 );
+
+        // of matches at the same place the first listed wins; replacements are not searched
+        String t{"abcabc"};
+        std::vector<std::pair<StringView, StringView>> pairs = { { "ab", "b" }, { "abc", "X" }, { "b", "ab" } };
+        assert( t.replace_all(pairs) == 2u );
+        assert( std::strcmp(t.c_str(), "bcbc") == 0 );
+    }
+
+    // replace_all - against a find / replace loop on std::string
+    {
+        unsigned seed = 3u;
+        auto next = [&seed]() { seed = seed * 1103515245u + 12345u; return seed >> 8; };
+
+        for(int round = 0; round < 200; ++round)
+        {
+            std::string ref;
+            for(unsigned n = next() % 80u; n != 0u; --n)
+                ref += static_cast<char>('a' + next() % 3u);
+
+            std::string pattern(1u + next() % 3u, 'a');
+            pattern.back() = static_cast<char>('a' + next() % 3u);
+            std::string replacement(next() % 5u, 'x');
+
+            String str{ref.data(), ref.size()};
+            if(next() % 2u != 0u)
+                str.reserve(200u);
+
+            size_t count = 0u;
+            for(size_t i = ref.find(pattern); i != std::string::npos; i = ref.find(pattern, i + replacement.size()))
+            {
+                ref.replace(i, pattern.size(), replacement);
+                ++count;
+            }
+
+            assert( str.replace_all(StringView{pattern.data(), pattern.size()},
+                                    StringView{replacement.data(), replacement.size()}) == count );
+            assert( std::string(str.data(), str.size()) == ref );
+            assert( std::strlen(str.c_str()) == str.size() );
+        }
+    }
+
+    // intern pool - one copy per contents, stable handles
+    {
+        InternPool pool;
+
+        String id{"customer_id"};
+        InternPool::handle a = pool.intern(id);
+        InternPool::handle b = pool.intern("customer_id");
+        InternPool::handle c = pool.intern(id.substr_view(0u, 8u));
+
+        assert( a == b && a != c );
+        assert( a.view() == "customer_id" && c.view() == "customer" );
+        assert( std::strcmp(c.c_str(), "customer") == 0 );
+        assert( pool.find("customer") == c && !pool.find("nope") );
+        assert( pool.intern("").view().empty() && pool.intern("") == pool.intern("") );
+
+        // handles stay put as the pool grows
+        const char* kept = a.c_str();
+        std::string big(100000u, 'z');
+        for(int i = 0; i < 20000; ++i)
+            pool.intern(StringView{"id_" + std::to_string(i)});
+        pool.intern(StringView{big});
+
+        assert( pool.size() == 20000u + 4u );
+        assert( a.c_str() == kept && pool.intern("customer_id") == a );
+        assert( pool.find(StringView{"id_12345"}).view() == "id_12345" );
+        assert( pool.find(StringView{big}).size() == big.size() );
+
+        wInternPool wpool;
+        assert( wpool.intern(L"wide") == wpool.intern(wString{L"wide"}) );
+    }
+
+    // intern pool - concurrent interning of overlapping sets
+    {
+        InternPool pool;
+        const int threads = 4;
+        const int names = 5000;
+
+        std::vector<std::vector<InternPool::handle>> handles(threads);
+        std::vector<std::thread> workers;
+        for(int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&pool, &handles, t, names]
+            {
+                for(int i = 0; i < names; ++i)
+                {
+                    int n = (i * 7 + t * 1000) % names; // each in its own order
+                    handles[t].push_back(pool.intern(StringView{"name_" + std::to_string(n)}));
+                }
+            });
+        }
+
+        for(std::thread& w : workers)
+            w.join();
+
+        assert( pool.size() == size_t(names) );
+        for(int t = 0; t < threads; ++t)
+        {
+            for(int i = 0; i < names; ++i)
+            {
+                int n = (i * 7 + t * 1000) % names;
+                assert( handles[t][i] == pool.find(StringView{"name_" + std::to_string(n)}) );
+                assert( handles[t][i].view() == StringView{"name_" + std::to_string(n)} );
+            }
+        }
+    }
+
+    // hashing - short and long inputs, and the vectorized accumulator
+    {
+        std::string data;
+        for(unsigned i = 0u; i < 5000u; ++i)
+            data += static_cast<char>(i * 2654435761u >> 24);
+
+        std::unordered_set<uint64_t> seen;
+        for(size_t n = 0u; n <= 3000u; ++n)
+            seen.insert(hashing::hash_bytes(data.data(), n));
+        assert( seen.size() == 3001u );
+
+        for(size_t n : { 1u, 7u, 16u, 17u, 100u, 256u, 257u, 1024u, 1025u, 4999u })
+        {
+            std::string flipped = data.substr(0u, n);
+            flipped[n / 2] ^= 1;
+            assert( hashing::hash_bytes(data.data(), n) != hashing::hash_bytes(flipped.data(), n) );
+            assert( hashing::hash_bytes(data.data(), n) != hashing::hash_bytes(data.data(), n, 1u) );
+        }
+
+#if BASIC_STRING_SIMD_X86
+        if(simd::has_avx2())
+        {
+            uint64_t a[8] = { 1u, 2u, 3u, 4u, 5u, 6u, 7u, 8u };
+            uint64_t b[8] = { 1u, 2u, 3u, 4u, 5u, 6u, 7u, 8u };
+            const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data());
+
+            hashing::accumulate_scalar(a, p + 3, 16u, hashing::keys_.data());
+            hashing::accumulate_avx2(b, p + 3, 16u, hashing::keys_.data());
+            assert( std::equal(a, a + 8, b) );
+
+            hashing::scramble_scalar(a, hashing::keys_.data() + 16);
+            hashing::scramble_avx2(b, hashing::keys_.data() + 16);
+            assert( std::equal(a, a + 8, b) );
+        }
+#endif
+    }
+
+    // hashing - std::hash, and transparent hashers
+    {
+        String s{"a key of some length, on the heap"};
+        pmr::String p{"a key of some length, on the heap"};
+
+        size_t h = std::hash<String>{}(s);
+        assert( h == std::hash<pmr::String>{}(p) );
+        assert( h == std::hash<StringView>{}(s) );
+        assert( h == StringHash{}("a key of some length, on the heap") );
+        assert( h != StringHash{}("a key of some length, on the heap!") );
+        assert( std::hash<wString>{}(L"abc") == wStringHash{}(L"abc") );
+
+        std::unordered_map<String, int, StringHash, StringEqual> map;
+        map[String{"one"}] = 1;
+        map[String{"two"}] = 2;
+        map[s] = 3;
+        assert( map.size() == 3u && map.at(String{"two"}) == 2 && map.at(s) == 3 );
+        assert( StringEqual{}(s, "a key of some length, on the heap") );
+    }
+
+    // hashing - a string that caches its hash
+    {
+        HashedString k{"cached key"};
+        size_t h = k.hash();
+        assert( h == StringHash{}("cached key") && k.hash() == h );
+
+        k.append("!", 1u);
+        assert( k.hash() == StringHash{}("cached key!") );
+
+        k.modify([](String& str) { str[0] = 'C'; });
+        assert( k.hash() == StringHash{}("Cached key!") );
+
+        HashedString copy = k;
+        assert( copy == k && copy.hash() == k.hash() );
+        copy.replace_all("key", "value");
+        assert( copy != k && copy.hash() == StringHash{}("Cached value!") );
+
+        std::unordered_set<HashedString> set;
+        set.insert(k);
+        set.insert(copy);
+        set.insert(HashedString{"Cached key!"});
+        assert( set.size() == 2u && set.count(HashedString{"Cached value!"}) == 1u );
+
+        String out = copy.release();
+        assert( copy.empty() && copy.hash() == StringHash{}("") );
+        assert( std::strcmp(out.c_str(), "Cached value!") == 0 );
+    }
+
+    // comparisons
+    {
+        String a = "apple";
+        String b = "apples";
+        String c = "banana";
+
+        assert( a == String("apple") && a != b );
+        assert( a == "apple" && "apple" == a && a != "apricot" );
+        assert( a == StringView("apple") && StringView("apple") == a );
+        assert( a == std::string_view("apple") );
+
+        assert( a < b && b < c && a <= a && c > b && c >= c && !(b < a) );
+        assert( a < "b" && "b" > a && StringView("apples") > a );
+
+        assert( a.compare("apple") == 0 && a.compare(b) < 0 && c.compare(a) > 0 );
+        assert( b.compare(0u, 5u, a) == 0 && b.compare(1u, 3u, "ppl") == 0 );
+
+        std::vector<String> keys = {"pear", "fig", "", "apple", "figs", "apricot"};
+        std::sort(keys.begin(), keys.end());
+        assert( std::is_sorted(keys.begin(), keys.end()) );
+        assert( keys.front() == "" && keys[1] == "apple" && keys.back() == "pear" );
+        assert( std::binary_search(keys.begin(), keys.end(), String("figs")) );
+
+        // wide chars order by value, not by their bytes
+        wString w1 = L"\x0100";
+        wString w2 = L"\x00ff";
+        assert( w2 < w1 && w1.compare(w2) > 0 && w1 != w2 );
+
+        BasicString<char16_t> u1 = u"long enough to go past one vector \x0100";
+        BasicString<char16_t> u2 = u"long enough to go past one vector \x00ff";
+        assert( u2 < u1 && u1.compare(u2) > 0 && u1 == u1 );
+    }
+
+    // string sort
+    {
+        // shared prefixes longer than a key, embedded nulls, empty and long strings
+        std::vector<String> keys;
+        uint32_t x = 12345u;
+        for(size_t i = 0u; i < 3000u; ++i)
+        {
+            x = x * 1664525u + 1013904223u;
+
+            String s = (x >> 28) % 2u == 0u ? "common prefix, " : "";
+            for(size_t len = (x >> 8) % 24u; len > 0u; --len)
+            {
+                x = x * 1664525u + 1013904223u;
+                s.push_back(static_cast<char>("ab\0\xff"[(x >> 20) % 4u]));
+            }
+
+            keys.push_back(s);
+        }
+
+        for(size_t len : {200u, 201u})
+        {
+            keys.emplace_back();
+            keys.back().resize(len, 'z');
+        }
+
+        std::vector<String> expected = keys;
+        std::sort(expected.begin(), expected.end());
+
+        std::vector<String> sorted = keys;
+        string_sort(sorted.begin(), sorted.end());
+        assert( sorted == expected );
+
+        std::vector<StringView> views(keys.begin(), keys.end());
+        string_sort(views.begin(), views.end());
+        assert( std::equal(views.begin(), views.end(), expected.begin(), expected.end()) );
+
+        std::vector<wString> wide = {L"\x0100", L"b", L"", L"\x00ff", L"bb", L"b"};
+        string_sort(wide.begin(), wide.end());
+        assert( std::is_sorted(wide.begin(), wide.end()) );
+    }
+
+    // parallel string sort
+    {
+        std::vector<String> keys;
+        for(size_t i = 0u; i < 20000u; ++i)
+            keys.push_back(String("key ") + String(std::to_string(i * 7919u % 20000u).c_str()));
+
+        std::vector<String> expected = keys;
+        std::sort(expected.begin(), expected.end());
+
+        parallel_string_sort(keys.begin(), keys.end(), 4u);
+        assert( keys == expected );
+    }
+
+    // stream output, with width and fill
+    {
+        String str = "abc";
+
+        std::ostringstream oss;
+        oss << "[" << std::setw(6) << std::setfill('.') << str << "]"
+            << "[" << std::left << std::setw(5) << str << "]"
+            << "[" << std::setw(2) << str << "]" << str;
+        assert( oss.str() == "[...abc][abc..][abc]abc" );
+
+        std::wostringstream woss;
+        woss << std::setw(4) << wString(L"xy") << wStringView(L"z");
+        assert( woss.str() == L"  xyz" );
+
+        // bigger than the buffer of the stream, and than the padding blocks
+        String body;
+        body.resize(100000u, 'x');
+
+        std::ostringstream big;
+        big << std::setw(100100) << body;
+        assert( big.str().size() == 100100u && big.str().find_first_not_of(' ') == 100u );
+    }
+
+    // stream input
+    {
+        std::istringstream iss("  hello   wide\tworld\nlonger-word");
+        String a, b, c, d;
+        iss >> a >> std::setw(3) >> b >> c >> d;
+        assert( a == "hello" && b == "wid" && c == "e" && d == "world" );
+
+        String e;
+        assert( iss >> e && e == "longer-word" && iss.eof() );
+        assert( !(iss >> e) );
+
+        std::istringstream lines("first\n\nthird line\nlast");
+        std::vector<String> got;
+        for(String line; getline(lines, line); )
+            got.push_back(line);
+
+        assert( got.size() == 4u && got[0] == "first" && got[1] == "" && got[2] == "third line" && got[3] == "last" );
+
+        std::istringstream fields("a,b,,c");
+        String field;
+        assert( getline(fields, field, ',') && field == "a" );
+        assert( getline(getline(fields, field, ','), field, ',') && field == "" );
+
+        // grows past the local buffer, and then the heap one, as it reads
+        std::string text(70000u, 'y');
+        std::istringstream long_line(text + "\nrest");
+        String line;
+        assert( getline(long_line, line) && line.size() == 70000u && line == StringView(text.data(), text.size()) );
+
+        std::wistringstream wiss(L"wide words");
+        wString w1, w2;
+        wiss >> w1 >> w2;
+        assert( w1 == L"wide" && w2 == L"words" );
+    }
+
+    // stream input - errors of the stream buffer
+    {
+        // rethrown when the stream asks for it, as std::string's extractors do
+        for(int k = 0; k < 2; ++k)
+        {
+            ThrowingStreamBuf buf{"abc"};
+            std::istream is{&buf};
+            is.exceptions(std::ios_base::badbit);
+
+            String str;
+            bool rethrown = false;
+            try
+            {
+                if(k == 0)
+                    is >> str;
+                else
+                    getline(is, str);
+            }
+            catch(const std::runtime_error& e)
+            {
+                rethrown = std::strcmp(e.what(), "read error") == 0;
+            }
+
+            assert( rethrown && is.bad() && str == "abc" );
+        }
+
+        // just badbit otherwise
+        ThrowingStreamBuf buf{"abc"};
+        std::istream is{&buf};
+        String str;
+        is >> str;
+        assert( is.bad() && str == "abc" );
+    }
+
+    // stream output - errors of the stream buffer
+    {
+        for(int k = 0; k < 2; ++k)
+        {
+            ThrowingStreamBuf buf{""};
+            std::ostream os{&buf};
+            os.exceptions(std::ios_base::badbit);
+
+            bool rethrown = false;
+            try
+            {
+                if(k == 0)
+                    os << String{"abc"};
+                else
+                    os << std::setw(10) << StringView{"abc"};
+            }
+            catch(const std::runtime_error& e)
+            {
+                rethrown = std::strcmp(e.what(), "write error") == 0;
+            }
+
+            assert( rethrown && os.bad() && os.width() == 0 );
+        }
+
+        ThrowingStreamBuf buf{""};
+        std::ostream os{&buf};
+        os << String{"abc"};
+        assert( os.bad() );
+    }
+
+    // mapped string
+    {
+        std::string path = (std::filesystem::temp_directory_path() / "basic_string_mapped_test.txt").string();
+        {
+            std::ofstream out(path, std::ios::binary);
+            out << "line one\nline two\n";
+            for(size_t i = 0u; i < 5000u; ++i)
+                out << "filler ";
+            out << "needle at the end";
+        }
+
+        MappedString text(path.c_str(), MappedString::access::sequential);
+        assert( text.size() == 18u + 5000u * 7u + 17u );
+        assert( text.substr_view(0u, 8u) == "line one" && text.substr(9u, 8u) == "line two" );
+        assert( text.find("needle") == 18u + 5000u * 7u && text.find("haystack") == MappedString::npos );
+        assert( text.find(String::searcher("the end")) == text.size() - 7u );
+        assert( text.compare("line") > 0 && text.back() == 'd' );
+
+        text.advise(MappedString::access::random, 100u, 10000u);
+        text.advise(MappedString::access::dont_need);
+        assert( text.split("\n").count() == 3u && text[5] == 'o' );
+
+        MappedString moved = std::move(text);
+        assert( text.empty() && moved.find("two") == 14u );
+
+        String copy{moved.substr_view()};
+        assert( moved == moved && moved == copy && copy == moved && moved == StringView(copy) );
+        assert( moved != "line one" && "line one" != moved && moved > "line one" && "line one" < moved );
+        assert( moved < "line onf" && moved <= "line onf" && "line onf" > moved && "line onf" >= moved );
+        assert( text == "" && text < moved && moved >= text );
+
+        {
+            std::ofstream out(path, std::ios::trunc);
+        }
+        MappedString empty(path.c_str());
+        assert( empty.empty() && empty.find("x") == MappedString::npos );
+
+        std::filesystem::remove(path);
+
+        bool thrown = false;
+        try
+        {
+            MappedString missing(path.c_str());
+        }
+        catch(const std::system_error& e)
+        {
+            thrown = e.code() == std::errc::no_such_file_or_directory;
+        }
+        assert( thrown );
+    }
+
+    // streaming search
+    {
+        // matches across chunk boundaries, overlapping ones, and one split over three chunks
+        StreamSearcher searcher("abab");
+        std::vector<size_t> found;
+        auto collect = [&found](size_t offset) { found.push_back(offset); };
+
+        for(StringView chunk : {"xxab", "ab", "abxa", "b", "a", "b", "--"})
+            searcher.feed(chunk, collect);
+
+        assert( (found == std::vector<size_t>{2u, 4u, 9u}) && searcher.offset() == 15u );
+
+        // a stream, in chunks smaller than the needle and bigger than it, with no new allocations
+        std::string text;
+        for(size_t i = 0u; i < 2000u; ++i)
+            text += i % 97u == 0u ? "the needle " : "some hay ";
+
+        std::vector<size_t> expected;
+        for(size_t i = text.find("needle"); i != std::string::npos; i = text.find("needle", i + 1))
+            expected.push_back(i);
+
+        for(size_t chunk : {3u, 100u, 4096u})
+        {
+            StreamSearcher s("needle");
+            std::istringstream in(text);
+
+            std::vector<size_t> offsets;
+            size_t cap = 0u;
+            size_t read = s.feed(in, [&](size_t offset)
+            {
+                offsets.push_back(offset);
+                cap = cap == 0u ? s.capacity() : cap;
+                assert( s.capacity() == cap );
+            }, chunk);
+
+            assert( read == text.size() && offsets == expected );
+        }
+
+        bool thrown = false;
+        try
+        {
+            StreamSearcher empty("");
+        }
+        catch(const std::invalid_argument&)
+        {
+            thrown = true;
+        }
+        assert( thrown );
+    }
+
+    // parallel search
+    {
+        String hay;
+        for(size_t i = 0u; i < 20000u; ++i)
+            hay.append(i % 1000u == 999u ? "abcab" : "abxy", i % 1000u == 999u ? 5u : 4u);
+
+        std::vector<size_t> expected;
+        for(size_t i = hay.find("abcab"); i != String::npos; i = hay.find("abcab", i + 1))
+            expected.push_back(i);
+
+        // tiny chunks, so that many matches straddle their borders
+        ThreadPool pool{4u};
+        ParallelOptions opts;
+        opts.pool = &pool;
+        opts.serial_below = 0u;
+        opts.min_chunk = 7u;
+
+        assert( par_find(hay, "abcab", opts) == expected.front() );
+        assert( par_count(hay, "abcab", opts) == expected.size() );
+        assert( par_find_all(hay, "abcab", opts) == expected );
+        assert( par_find(hay, "zzz", opts) == String::npos && par_count(hay, "zzz", opts) == 0u );
+
+        // overlapping matches, and the serial path
+        String as;
+        as.resize(5000u, 'a');
+        assert( par_count(as, "aa", opts) == 4999u && par_count(StringView(as), "aa") == 4999u );
+        assert( par_find_all(as, "aaa", opts).size() == 4998u && par_find(as, "aaa", opts) == 0u );
+        assert( par_find(hay, "abcab") == expected.front() && par_find_all(hay, "abcab") == expected );
+
+        // an empty needle is an error, for all three
+        int empty_thrown = 0;
+        try { par_find(hay, ""); } catch(const std::invalid_argument&) { ++empty_thrown; }
+        try { par_count(hay, ""); } catch(const std::invalid_argument&) { ++empty_thrown; }
+        try { par_find_all(String{}, "", opts); } catch(const std::invalid_argument&) { ++empty_thrown; }
+        assert( empty_thrown == 3 );
+
+        // the pool passes exceptions on
+        bool thrown = false;
+        try
+        {
+            pool.for_each_index(100u, [](size_t i)
+            {
+                if(i == 42u)
+                    throw std::runtime_error{"42"};
+            });
+        }
+        catch(const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        assert( thrown );
+    }
+
+    // utf-8 validation
+    {
+        assert( validate_utf8("") && validate_utf8("plain ascii") );
+        assert( validate_utf8("caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 \xf4\x8f\xbf\xbf") );
+
+        const char* bad[] = {
+            "\x80",             // a lone continuation
+            "\xc3",             // truncated
+            "\xe2\x82",
+            "\xc0\xaf",         // overlong
+            "\xe0\x80\xaf",
+            "\xf0\x80\x80\xaf",
+            "\xed\xa0\x80",     // a surrogate
+            "\xf4\x90\x80\x80", // past U+10FFFF
+            "\xff",
+            "\xc3\xa9\xa9",     // one continuation too many
+        };
+
+        // alone, and at either end and across the middle of blocks of ASCII
+        String pad;
+        pad.resize(40u, 'a');
+        for(const char* b : bad)
+        {
+            assert( !validate_utf8(b) );
+            for(size_t at : {0u, 30u, 31u, 33u, 39u})
+            {
+                String s = pad;
+                s.insert(at, b);
+                assert( !validate_utf8(s) && !utf::validate_utf8_scalar(reinterpret_cast<const unsigned char*>(s.data()), s.size()) );
+            }
+        }
+
+        String good;
+        for(size_t i = 0u; i < 100u; ++i)
+            good.append("x\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80", 10u);
+
+        assert( validate_utf8(good) && utf8_length(good) == 400u );
+    }
+
+    // utf-8 transcoding
+    {
+        String text = "a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80 and some ascii to go past one block";
+
+        BasicString<char16_t> u16 = utf8_to_utf16(text);
+        assert( u16.size() == 41u && u16[1] == 0xe9 && u16[2] == 0x20ac && u16[3] == 0xd83d && u16[4] == 0xde00 );
+        assert( u16.capacity() == u16.size() );
+
+        BasicString<char32_t> u32 = utf8_to_utf32(text);
+        assert( u32.size() == 40u && u32[3] == 0x1f600 && u32[39] == U'k' );
+
+        wString w = utf8_to_wstring(text);
+        assert( w.size() == (sizeof(wchar_t) == 2u ? 41u : 40u) );
+
+        assert( utf16_to_utf8(u16) == text && utf32_to_utf8(u32) == text && wstring_to_utf8(w) == text );
+        assert( utf8_to_utf16("").empty() && utf16_to_utf8(u"").empty() );
+
+        bool thrown = false;
+        try
+        {
+            utf8_to_utf32("\xc3(");
+        }
+        catch(const std::range_error&)
+        {
+            thrown = true;
+        }
+        assert( thrown );
+
+        char16_t lone[] = {u'a', 0xd800, u'b', 0};
+        char32_t huge[] = {0x110000, 0};
+        thrown = false;
+        try
+        {
+            utf16_to_utf8(lone);
+        }
+        catch(const std::range_error&)
+        {
+            thrown = true;
+        }
+        assert( thrown );
+
+        thrown = false;
+        try
+        {
+            utf32_to_utf8(huge);
+        }
+        catch(const std::range_error&)
+        {
+            thrown = true;
+        }
+        assert( thrown );
+    }
+
     std::cout << "PASSED" << std::endl;
 }